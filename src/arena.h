@@ -0,0 +1,78 @@
+#pragma once
+#include "core_types.h"
+
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <type_traits>
+
+//Bump allocator for parsed property trees. Nodes made from an arena live exactly as long as it does,
+//so nothing holding them has to delete anything: dropping the arena tears the whole tree down.
+//That goes for nodes an edit replaces too, so editors should reuse nodes rather than make new ones.
+struct Arena {
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena &operator=(const Arena&) = delete;
+	~Arena() {
+		release();
+	}
+
+	template<typename T, typename... Args>
+	T *make(Args&&... args) {
+		void *mem = allocate(sizeof(T), alignof(T));
+		T *obj = new (mem) T(std::forward<Args>(args)...);
+
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			destructors.push_back({ obj, [](void *p) { static_cast<T*>(p)->~T(); } });
+		}
+
+		++objectCount;
+		return obj;
+	}
+
+	//Destroys everything made from the arena, newest first
+	void release() {
+		for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+			it->destroy(it->obj);
+		}
+		destructors.clear();
+		blocks.clear();
+		cur = nullptr;
+		remaining = 0;
+		objectCount = 0;
+	}
+
+	size_t objects() const { return objectCount; }
+	size_t blockCount() const { return blocks.size(); }
+
+private:
+	struct Destructor {
+		void *obj;
+		void (*destroy)(void*);
+	};
+
+	void *allocate(size_t size, size_t align) {
+		size_t pad = (align - ((uintptr_t)cur & (align - 1))) & (align - 1);
+		if (cur == nullptr || pad + size > remaining) {
+			size_t blockSize = std::max(BLOCK_SIZE, size + align);
+			blocks.emplace_back(new u8[blockSize]);
+			cur = blocks.back().get();
+			remaining = blockSize;
+			pad = (align - ((uintptr_t)cur & (align - 1))) & (align - 1);
+		}
+
+		cur += pad;
+		void *mem = cur;
+		cur += size;
+		remaining -= pad + size;
+		return mem;
+	}
+
+	std::vector<std::unique_ptr<u8[]>> blocks;
+	std::vector<Destructor> destructors;
+	u8 *cur = nullptr;
+	size_t remaining = 0;
+	size_t objectCount = 0;
+};
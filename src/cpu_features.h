@@ -0,0 +1,116 @@
+#pragma once
+#include "core_types.h"
+
+//Runtime checks for the instruction set extensions the hashing code has fast paths for. Each check
+//runs once, later calls only read the cached answer.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define CPU_ARM64
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#else
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+//MSVC lets any function use any intrinsic, GCC and Clang need the instruction sets named per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CPU_TARGET(x)
+#else
+#define CPU_TARGET(x) __attribute__((target(x)))
+#endif
+
+namespace cpu {
+#ifdef CPU_X86
+	inline void cpuid(int leaf, int subleaf, u32 regs[4]) {
+#ifdef _MSC_VER
+		int r[4];
+		__cpuidex(r, leaf, subleaf);
+		for (int i = 0; i < 4; ++i) {
+			regs[i] = (u32)r[i];
+		}
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	struct X86Features {
+		bool ssse3 = false;
+		bool sse41 = false;
+		bool pclmul = false;
+		bool sha = false;
+
+		X86Features() {
+			u32 regs[4];
+			cpuid(0, 0, regs);
+			u32 maxLeaf = regs[0];
+
+			cpuid(1, 0, regs);
+			ssse3 = (regs[2] & (1 << 9)) != 0;
+			sse41 = (regs[2] & (1 << 19)) != 0;
+			pclmul = (regs[2] & (1 << 1)) != 0;
+
+			if (maxLeaf >= 7) {
+				cpuid(7, 0, regs);
+				sha = (regs[1] & (1 << 29)) != 0;
+			}
+		}
+	};
+
+	inline const X86Features &x86() {
+		static const X86Features features;
+		return features;
+	}
+#endif
+
+#ifdef CPU_ARM64
+	struct ArmFeatures {
+		bool sha1 = false;
+		bool crc32 = false;
+
+		ArmFeatures() {
+#ifdef _WIN32
+			sha1 = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+			crc32 = IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != 0;
+#elif defined(__APPLE__)
+			//Every Apple silicon chip has both, older macOS just doesn't list them
+			sha1 = sysctlFlag("hw.optional.arm.FEAT_SHA1", true);
+			crc32 = sysctlFlag("hw.optional.armv8_crc32", true);
+#else
+			unsigned long hwcap = getauxval(AT_HWCAP);
+			sha1 = (hwcap & HWCAP_SHA1) != 0;
+			crc32 = (hwcap & HWCAP_CRC32) != 0;
+#endif
+		}
+
+#ifdef __APPLE__
+		static bool sysctlFlag(const char *name, bool missing) {
+			int present = 0;
+			size_t size = sizeof(present);
+			if (sysctlbyname(name, &present, &size, nullptr, 0) != 0) {
+				return missing;
+			}
+			return present != 0;
+		}
+#endif
+	};
+
+	inline const ArmFeatures &arm() {
+		static const ArmFeatures features;
+		return features;
+	}
+#endif
+}
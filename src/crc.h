@@ -2,9 +2,53 @@
 #pragma once
 
 #include "core_types.h"
+#include "cpu_features.h"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#ifdef CPU_X86
+#define CRC_PCLMUL
+#endif
+
+//Only compiled in where the compiler already targets the CRC32 instructions (Apple silicon, Windows
+//on ARM, or -march=armv8-a+crc), whether the CPU has them is still checked at runtime
+#if defined(CPU_ARM64) && (defined(__ARM_FEATURE_CRC32) || defined(_M_ARM64))
+#define CRC_ARMV8
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <arm_acle.h>
+#endif
+#endif
+
+//Slicing-by-16 tables for the reflected CRC-32 polynomial. Table 0 is the plain byte at a time one,
+//table k advances a byte through k more zero bytes.
+struct CRCSliceTables {
+	u32 t[16][256];
+};
+
+constexpr CRCSliceTables MakeCRCSliceTables() {
+	CRCSliceTables Tables = {};
+	for (u32 i = 0; i < 256; ++i) {
+		u32 C = i;
+		for (i32 b = 0; b < 8; ++b) {
+			C = (C & 1) ? 0xEDB88320 ^ (C >> 1) : C >> 1;
+		}
+		Tables.t[0][i] = C;
+	}
+	for (u32 k = 1; k < 16; ++k) {
+		for (u32 i = 0; i < 256; ++i) {
+			u32 Prev = Tables.t[k - 1][i];
+			Tables.t[k][i] = (Prev >> 8) ^ Tables.t[0][Prev & 0xFF];
+		}
+	}
+	return Tables;
+}
 
 struct CRC {
-	inline static const u32 CRCTablesSB8[8][256] =
+	inline static constexpr u32 CRCTablesSB8[8][256] =
 	{
 		{
 			0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
@@ -152,57 +196,270 @@ struct CRC {
 		}
 	};
 
-	template <typename T>
-	static constexpr T Align(T Val, u64 Alignment) {
-		return (T)(((u64)Val + Alignment - 1) & ~(Alignment - 1));
+	//Only used for the non case preserving hash stored with FNames
+	inline static const u32 CRCTable_DEPRECATED[256] =
+	{
+		0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b, 0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61, 0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd,
+		0x4c11db70, 0x48d0c6c7, 0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75, 0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3, 0x709f7b7a, 0x745e66cd,
+		0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039, 0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef, 0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
+		0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb, 0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1, 0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d,
+		0x34867077, 0x30476dc0, 0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072, 0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4, 0x0808d07d, 0x0cc9cdca,
+		0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde, 0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08, 0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
+		0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc, 0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6, 0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a,
+		0xe0b41de7, 0xe4750050, 0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2, 0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34, 0xdc3abded, 0xd8fba05a,
+		0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637, 0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1, 0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
+		0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5, 0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff, 0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623,
+		0xf12f560e, 0xf5ee4bb9, 0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b, 0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd, 0xcda1f604, 0xc960ebb3,
+		0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7, 0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71, 0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
+		0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2, 0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8, 0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24,
+		0x119b4be9, 0x155a565e, 0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec, 0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a, 0x2d15ebe3, 0x29d4f654,
+		0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0, 0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676, 0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
+		0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662, 0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668, 0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
+	};
+
+	//Slicing-by-16 tables, the first eight are the same as the slice-by-8 ones above
+	inline static constexpr CRCSliceTables CRCTablesSB16 = MakeCRCSliceTables();
+
+	//Ways to run MemCrc32. The fastest one the CPU supports is picked on first use.
+	enum class Impl {
+		SliceBy16,
+		Pclmul,
+		ArmV8,
+	};
+
+	static bool Supported(Impl impl) {
+		switch (impl) {
+		case Impl::SliceBy16:
+			return true;
+#ifdef CRC_PCLMUL
+		case Impl::Pclmul:
+			return cpu::x86().pclmul && cpu::x86().sse41;
+#endif
+#ifdef CRC_ARMV8
+		case Impl::ArmV8:
+			return cpu::arm().crc32;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	static Impl Implementation() {
+		return ActiveImpl().load(std::memory_order_relaxed);
+	}
+
+	//For benchmarks and checking the fast paths against SliceBy16. False if the CPU can't run impl.
+	static bool SetImplementation(Impl impl) {
+		if (!Supported(impl)) {
+			return false;
+		}
+
+		ActiveImpl().store(impl, std::memory_order_relaxed);
+		return true;
+	}
+
+	static const char *Name(Impl impl) {
+		switch (impl) {
+		case Impl::SliceBy16: return "slice-by-16";
+		case Impl::Pclmul: return "PCLMULQDQ";
+		case Impl::ArmV8: return "ARMv8";
+		}
+		return "?";
 	}
 
 	static u32 MemCrc32(const void* InData, i32 Length, u32 CRC = 0)
 	{
-		// Based on the Slicing-by-8 implementation found here:
-		// http://slicing-by-8.sourceforge.net/
-
+		const u8* Data = (const u8*)InData;
 		CRC = ~CRC;
 
-		const u8* __restrict Data = (u8*)InData;
+		switch (Implementation()) {
+#ifdef CRC_PCLMUL
+		case Impl::Pclmul:
+			if (Length >= 64) {
+				i32 Folded = Length & ~15;
+				CRC = FoldPclmul(Data, Folded, CRC);
+				Data += Folded;
+				Length -= Folded;
+			}
+			break;
+#endif
+#ifdef CRC_ARMV8
+		case Impl::ArmV8:
+			return ~CrcArmV8(Data, Length, CRC);
+#endif
+		default:
+			break;
+		}
 
-		// First we need to align to 32-bits
-		i32 InitBytes = Align(Data, 4) - Data;
+		return ~SliceBy16(Data, Length, CRC);
+	}
 
-		if (Length > InitBytes)
-		{
-			Length -= InitBytes;
+	template <typename CharType>
+	static CharType ToUpper(CharType Ch)
+	{
+		return (Ch >= 'a' && Ch <= 'z') ? (CharType)(Ch - ('a' - 'A')) : Ch;
+	}
 
-			for (; InitBytes; --InitBytes)
+	//Case insensitive string hash. ANSI chars are hashed as one byte, wide ones as two.
+	template <typename CharType>
+	static u32 Strihash_DEPRECATED(const CharType* Data, size_t Length)
+	{
+		u32 Hash = 0;
+		for (size_t i = 0; i < Length; ++i)
+		{
+			u32 Ch = (std::make_unsigned_t<CharType>)ToUpper(Data[i]);
+			for (size_t b = 0; b < sizeof(CharType); ++b)
 			{
-				CRC = (CRC >> 8) ^ CRCTablesSB8[0][(CRC & 0xFF) ^ *Data++];
+				Hash = ((Hash >> 8) & 0x00FFFFFF) ^ CRCTable_DEPRECATED[(Hash ^ Ch) & 0x000000FF];
+				Ch >>= 8;
 			}
+		}
+		return Hash;
+	}
 
-			auto Data4 = (const u32*)Data;
-			for (u32 Repeat = Length / 8; Repeat; --Repeat)
+	//Case sensitive string CRC, every char is hashed as four bytes whatever its width
+	template <typename CharType>
+	static u32 StrCrc32(const CharType* Data, size_t Length, u32 CRC = 0)
+	{
+		CRC = ~CRC;
+		for (size_t i = 0; i < Length; ++i)
+		{
+			u32 Ch = (std::make_unsigned_t<CharType>)Data[i];
+			for (i32 b = 0; b < 4; ++b)
 			{
-				u32 V1 = *Data4++ ^ CRC;
-				u32 V2 = *Data4++;
-				CRC =
-					CRCTablesSB8[7][V1 & 0xFF] ^
-					CRCTablesSB8[6][(V1 >> 8) & 0xFF] ^
-					CRCTablesSB8[5][(V1 >> 16) & 0xFF] ^
-					CRCTablesSB8[4][V1 >> 24] ^
-					CRCTablesSB8[3][V2 & 0xFF] ^
-					CRCTablesSB8[2][(V2 >> 8) & 0xFF] ^
-					CRCTablesSB8[1][(V2 >> 16) & 0xFF] ^
-					CRCTablesSB8[0][V2 >> 24];
+				CRC = (CRC >> 8) ^ CRCTablesSB8[0][(CRC ^ Ch) & 0xFF];
+				Ch >>= 8;
 			}
-			Data = (const u8*)Data4;
+		}
+		return ~CRC;
+	}
+
+private:
+	//Entries get hashed from several threads at once, so the choice is made once and then only read
+	static std::atomic<Impl> &ActiveImpl() {
+		static std::atomic<Impl> impl{ FastestImpl() };
+		return impl;
+	}
+
+	static Impl FastestImpl() {
+		for (auto impl : { Impl::Pclmul, Impl::ArmV8 }) {
+			if (Supported(impl)) {
+				return impl;
+			}
+		}
+		return Impl::SliceBy16;
+	}
 
-			Length %= 8;
+	//CRC is the running value already inverted, the same goes for the result
+	static u32 SliceBy16(const u8* Data, i32 Length, u32 CRC)
+	{
+		// Slicing-by-16, the slice-by-8 scheme from http://slicing-by-8.sourceforge.net/ widened to
+		// four words per step
+		const auto& T = CRCTablesSB16.t;
+		for (; Length >= 16; Length -= 16, Data += 16)
+		{
+			u32 V[4];
+			memcpy(V, Data, sizeof(V));
+			V[0] ^= CRC;
+			CRC =
+				T[15][V[0] & 0xFF] ^ T[14][(V[0] >> 8) & 0xFF] ^ T[13][(V[0] >> 16) & 0xFF] ^ T[12][V[0] >> 24] ^
+				T[11][V[1] & 0xFF] ^ T[10][(V[1] >> 8) & 0xFF] ^ T[9][(V[1] >> 16) & 0xFF] ^ T[8][V[1] >> 24] ^
+				T[7][V[2] & 0xFF] ^ T[6][(V[2] >> 8) & 0xFF] ^ T[5][(V[2] >> 16) & 0xFF] ^ T[4][V[2] >> 24] ^
+				T[3][V[3] & 0xFF] ^ T[2][(V[3] >> 8) & 0xFF] ^ T[1][(V[3] >> 16) & 0xFF] ^ T[0][V[3] >> 24];
 		}
 
 		for (; Length; --Length)
 		{
-			CRC = (CRC >> 8) ^ CRCTablesSB8[0][(CRC & 0xFF) ^ *Data++];
+			CRC = (CRC >> 8) ^ T[0][(CRC & 0xFF) ^ *Data++];
 		}
 
-		return ~CRC;
+		return CRC;
+	}
+
+#ifdef CRC_PCLMUL
+	// Carries X forward over 128 bits with the constant pair K and adds in the next 128 bits
+	CPU_TARGET("pclmul,sse4.1")
+	static __m128i Fold(__m128i X, __m128i K, __m128i Next)
+	{
+		__m128i Lo = _mm_clmulepi64_si128(X, K, 0x00);
+		__m128i Hi = _mm_clmulepi64_si128(X, K, 0x11);
+		return _mm_xor_si128(_mm_xor_si128(Hi, Lo), Next);
+	}
+
+	// Folds four 128 bit lanes at a time with carry-less multiplies, then reduces to 32 bits. From
+	// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Gopal et al.), as
+	// used by zlib. Length must be at least 64 and a multiple of 16.
+	CPU_TARGET("pclmul,sse4.1")
+	static u32 FoldPclmul(const u8* Data, i32 Length, u32 CRC)
+	{
+		const __m128i K1K2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+		const __m128i K3K4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+		const __m128i K5K0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+		const __m128i Poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+		const __m128i Mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+		__m128i X1 = _mm_loadu_si128((const __m128i*)(Data + 0x00));
+		__m128i X2 = _mm_loadu_si128((const __m128i*)(Data + 0x10));
+		__m128i X3 = _mm_loadu_si128((const __m128i*)(Data + 0x20));
+		__m128i X4 = _mm_loadu_si128((const __m128i*)(Data + 0x30));
+		X1 = _mm_xor_si128(X1, _mm_cvtsi32_si128((int)CRC));
+		Data += 64;
+		Length -= 64;
+
+		for (; Length >= 64; Length -= 64, Data += 64)
+		{
+			X1 = Fold(X1, K1K2, _mm_loadu_si128((const __m128i*)(Data + 0x00)));
+			X2 = Fold(X2, K1K2, _mm_loadu_si128((const __m128i*)(Data + 0x10)));
+			X3 = Fold(X3, K1K2, _mm_loadu_si128((const __m128i*)(Data + 0x20)));
+			X4 = Fold(X4, K1K2, _mm_loadu_si128((const __m128i*)(Data + 0x30)));
+		}
+
+		X1 = Fold(X1, K3K4, X2);
+		X1 = Fold(X1, K3K4, X3);
+		X1 = Fold(X1, K3K4, X4);
+
+		for (; Length >= 16; Length -= 16, Data += 16)
+		{
+			X1 = Fold(X1, K3K4, _mm_loadu_si128((const __m128i*)Data));
+		}
+
+		// 128 bits down to 64
+		__m128i X2b = _mm_clmulepi64_si128(X1, K3K4, 0x10);
+		X1 = _mm_xor_si128(_mm_srli_si128(X1, 8), X2b);
+
+		X2b = _mm_srli_si128(X1, 4);
+		X1 = _mm_and_si128(X1, Mask32);
+		X1 = _mm_clmulepi64_si128(X1, K5K0, 0x00);
+		X1 = _mm_xor_si128(X1, X2b);
+
+		// Barrett reduction to 32 bits
+		X2b = _mm_and_si128(X1, Mask32);
+		X2b = _mm_clmulepi64_si128(X2b, Poly, 0x10);
+		X2b = _mm_and_si128(X2b, Mask32);
+		X2b = _mm_clmulepi64_si128(X2b, Poly, 0x00);
+		X1 = _mm_xor_si128(X1, X2b);
+
+		return (u32)_mm_extract_epi32(X1, 1);
+	}
+#endif
+
+#ifdef CRC_ARMV8
+	// The CRC32 instructions use the same polynomial, eight bytes per instruction
+	static u32 CrcArmV8(const u8* Data, i32 Length, u32 CRC)
+	{
+		for (; Length >= 8; Length -= 8, Data += 8)
+		{
+			u64 V;
+			memcpy(&V, Data, sizeof(V));
+			CRC = __crc32d(CRC, V);
+		}
+
+		for (; Length; --Length)
+		{
+			CRC = __crc32b(CRC, *Data++);
+		}
+
+		return CRC;
 	}
-};
\ No newline at end of file
+#endif
+};
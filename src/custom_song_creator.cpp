@@ -69,6 +69,24 @@ struct AudioCtx {
 };
 AudioCtx gAudio;
 bool unsavedChanges = false;
+
+//Every edit to the song goes through these. An edit to an entry's own data (fusion patch, midi, texture)
+//passes that entry, so the next save serializes it again instead of copying its old bytes.
+static void markEdited(PakFile::PakEntry *entry = nullptr) {
+	unsavedChanges = true;
+	if (entry) {
+		entry->markDirty();
+	}
+}
+
+template<typename T, typename V>
+static void setEdited(PakFile::PakEntry *entry, T &field, const V &value) {
+	if (!(field == value)) {
+		field = value;
+		markEdited(entry);
+	}
+}
+
 bool closePressed = false;
 bool filenameArg = false;
 std::string filenameArgPath;
@@ -259,7 +277,7 @@ static void ChooseFuserEnum(const char* label, std::string& out, bool hideLast =
 
 	if (ImGui::Combo(label, &currentChoice, getter, &values, itemsCount)) {
 		out = values[currentChoice];
-		unsavedChanges = true;
+		markEdited();
 	}
 }
 
@@ -278,7 +296,7 @@ static void ChooseFuserEnum(const char* label, typename T::Value& out, bool hide
 	int currentChoice = static_cast<int>(out);
 	if (ImGui::Combo(label, &currentChoice, getter, &values, itemCount)) {
 		out = static_cast<typename T::Value>(currentChoice);
-		unsavedChanges = true;
+		markEdited();
 	}
 }
 
@@ -349,7 +367,11 @@ struct MainContext {
 MainContext gCtx;
 
 
-void load_file(DataBuffer&& dataBuf) {
+bool Error_LoadFailed = false;
+std::string lastLoadError;
+
+//Returns false (and shows an error) if the pak couldn't be parsed
+bool load_file(DataBuffer&& dataBuf) {
 	unsavedChanges = false;
 	gCtx.has_art = false;
 	gCtx.currentPak.reset();
@@ -358,78 +380,84 @@ void load_file(DataBuffer&& dataBuf) {
 
 	auto&& pak = gCtx.currentPak->pak;
 
-	dataBuf.serialize(pak);
-	int i = 0;
-	for (auto&& e : pak.entries) {
-		if (auto data = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
-			auto pos = e.name.find("DLC/Songs/");
-			if (pos != std::string::npos) {
-				std::string shortName;
-				for (size_t i = 10; i < e.name.size(); ++i) {
-					if (e.name[i] == '/') {
-						break;
-					}
+	//The song walks every export, so they're parsed during the load where it can spread them over
+	//the workers, and a corrupt export fails the load instead of whatever touches it first later on.
+	pak.parseExportsOnLoad = true;
+	try {
+		dataBuf.serialize(pak);
+
+		int i = 0;
+		for (auto&& e : pak.entries) {
+			if (auto data = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
+				auto pos = e.name.find("DLC/Songs/");
+				if (pos != std::string::npos) {
+					std::string shortName;
+					for (size_t i = 10; i < e.name.size(); ++i) {
+						if (e.name[i] == '/') {
+							break;
+						}
 
-					shortName += e.name[i];
-				}
+						shortName += e.name[i];
+					}
 
-				//Double check we got the name correct
-				if (e.name == ("DLC/Songs/" + shortName + "/Meta_" + shortName + ".uexp")) {
-					gCtx.currentPak->root.shortName = shortName;
-					//break;
+					//Double check we got the name correct
+					if (e.name == ("DLC/Songs/" + shortName + "/Meta_" + shortName + ".uexp")) {
+						gCtx.currentPak->root.shortName = shortName;
+						//break;
+					}
 				}
-			}
-			pos = e.name.find("UI/AlbumArt");
-			if (pos != std::string::npos) {
-				if (e.name.compare(e.name.length() - 5, 5, ".uexp") == 0) {
-					if (auto texture = std::get_if<Texture2D>(&data->data.catagoryValues[0].value)) {
-						pos = e.name.find("_small");
-						if (pos == std::string::npos) {
-							auto dds = DDSFile();
-							dds.VInitializeFromRaw(&texture->mips[0].mipData[0], texture->mips[0].mipData.size(), texture->mips[0].width, texture->mips[0].height);
-							gCtx.art = ImageFile();
-
-							uint8_t* uncompressedImageData = new uint8_t[texture->mips[0].width * texture->mips[0].height * 4];
-							auto width = texture->mips[0].width;
-							auto height = texture->mips[0].height;
-
-							uint8_t* uncompressedData_ = dds.VGetUncompressedImageData();
-							for (int y = 0; y < height; y++) {
-								for (int x = 0; x < width; x++) {
-									uncompressedImageData[(x + width * y) * 4 + 0] = uncompressedData_[(x + width * (height - 1 - y)) * 3 + 0];
-									uncompressedImageData[(x + width * y) * 4 + 1] = uncompressedData_[(x + width * (height - 1 - y)) * 3 + 1];
-									uncompressedImageData[(x + width * y) * 4 + 2] = uncompressedData_[(x + width * (height - 1 - y)) * 3 + 2];
-									uncompressedImageData[(x + width * y) * 4 + 3] = 255;
+				pos = e.name.find("UI/AlbumArt");
+				if (pos != std::string::npos) {
+					if (e.name.compare(e.name.length() - 5, 5, ".uexp") == 0) {
+						if (auto texture = std::get_if<Texture2D>(&data->data.catagoryValues[0].value())) {
+							pos = e.name.find("_small");
+							if (pos == std::string::npos) {
+								auto dds = DDSFile();
+								dds.VInitializeFromRaw((u8*)texture->mips[0].mipData.data(), texture->mips[0].mipData.size(), texture->mips[0].width, texture->mips[0].height);
+								gCtx.art = ImageFile();
+
+								uint8_t* uncompressedImageData = new uint8_t[texture->mips[0].width * texture->mips[0].height * 4];
+								auto width = texture->mips[0].width;
+								auto height = texture->mips[0].height;
+
+								uint8_t* uncompressedData_ = dds.VGetUncompressedImageData();
+								for (int y = 0; y < height; y++) {
+									for (int x = 0; x < width; x++) {
+										uncompressedImageData[(x + width * y) * 4 + 0] = uncompressedData_[(x + width * (height - 1 - y)) * 3 + 0];
+										uncompressedImageData[(x + width * y) * 4 + 1] = uncompressedData_[(x + width * (height - 1 - y)) * 3 + 1];
+										uncompressedImageData[(x + width * y) * 4 + 2] = uncompressedData_[(x + width * (height - 1 - y)) * 3 + 2];
+										uncompressedImageData[(x + width * y) * 4 + 3] = 255;
+									}
 								}
+								gCtx.art.FromBytes(uncompressedImageData, texture->mips[0].width * texture->mips[0].height * 4, texture->mips[0].width, texture->mips[0].height);
+								gCtx.has_art = true;
 							}
-							gCtx.art.FromBytes(uncompressedImageData, texture->mips[0].width * texture->mips[0].height * 4, texture->mips[0].width, texture->mips[0].height);
-							gCtx.has_art = true;
 						}
 					}
 				}
-			}
-			i++;
+				i++;
 
+			}
 		}
-	}
-
-	if (gCtx.currentPak->root.shortName.empty()) {
-		printf("FATAL ERROR! No short name detected!");
-		__debugbreak();
-	}
 
+		if (gCtx.currentPak->root.shortName.empty()) {
+			printf("FATAL ERROR! No short name detected!");
+			__debugbreak();
+		}
 
-	if (gCtx.has_art) {
 		SongSerializationCtx ctx;
 		ctx.loading = true;
 		ctx.pak = &pak;
 		gCtx.currentPak->root.serialize(ctx);
 	}
-	else {
-		SongSerializationCtx ctx;
-		ctx.loading = true;
-		ctx.pak = &pak;
-		gCtx.currentPak->root.serialize(ctx);
+	catch (const ParseError &e) {
+		gCtx.currentPak.reset();
+		lastLoadError = e.what();
+		Error_LoadFailed = true;
+		return false;
+	}
+
+	if (!gCtx.has_art) {
 		std::string shortName = gCtx.currentPak->root.shortName;
 		std::string songName = gCtx.currentPak->root.songName;
 		std::string artistName = gCtx.currentPak->root.artistName;
@@ -445,7 +473,7 @@ void load_file(DataBuffer&& dataBuf) {
 		for (auto cel : gCtx.currentPak->root.celData) {
 			celShortName.emplace_back(cel.data.shortName);
 			auto&& fusionFile = cel.data.majorAssets[0].data.fusionFile.data;
-			auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
+			auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
 			auto&& mogg = asset.audio.audioFiles[0];
 
 			HmxAudio::PackageFile fusionPackageFile;
@@ -466,8 +494,7 @@ void load_file(DataBuffer&& dataBuf) {
 		}
 
 		DataBuffer dataBuf;
-		dataBuf.buffer = (u8*)custom_song_pak_template;
-		dataBuf.size = sizeof(custom_song_pak_template);
+		dataBuf.setupMemory((u8*)custom_song_pak_template, sizeof(custom_song_pak_template));
 		load_file(std::move(dataBuf));
 
 		gCtx.currentPak->root.shortName = shortName;
@@ -483,8 +510,9 @@ void load_file(DataBuffer&& dataBuf) {
 		for (auto& cel : gCtx.currentPak->root.celData) {
 			
 			cel.data.shortName = celShortName[idx];
+			//The template is loaded from memory, so its entries have no saved bytes and are always serialized
 			auto&& fusionFile = cel.data.majorAssets[0].data.fusionFile.data;
-			auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
+			auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
 			auto&& mogg = asset.audio.audioFiles[0];
 
 			cel.data.instrument = instrumentTypes[idx];
@@ -532,21 +560,21 @@ void load_file(DataBuffer&& dataBuf) {
 
 	}
 
+	return true;
 }
 
 void load_template() {
 	gCtx.currentPak.reset();
 	DataBuffer dataBuf;
-	dataBuf.buffer = (u8*)custom_song_pak_template;
-	dataBuf.size = sizeof(custom_song_pak_template);
+	dataBuf.setupMemory((u8*)custom_song_pak_template, sizeof(custom_song_pak_template));
 	load_file(std::move(dataBuf));
 	gCtx.currentPak.get()->root.shortName = fcsc_cfg.defaultShortName;
 	int celIdx = 0;
 	for (auto& cel : gCtx.currentPak.get()->root.celData) {
 		auto&& fusionFile = cel.data.majorAssets[0].data.fusionFile.data;
 		auto&& fusionFileRiser = cel.data.songTransitionFile.data.majorAssets[0].data.fusionFile.data;
-		auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
-		auto&& assetRiser = std::get<HmxAssetFile>(fusionFileRiser.file.e->getData().data.catagoryValues[0].value);
+		auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
+		auto&& assetRiser = std::get<HmxAssetFile>(fusionFileRiser.file.e->getData().data.catagoryValues[0].value());
 
 		HmxAudio::PackageFile* fusionPackageFile = nullptr;
 		HmxAudio::PackageFile* fusionPackageFileRiser = nullptr;
@@ -582,19 +610,10 @@ void load_template() {
 	}
 }
 
-void write_sig(DataBuffer outBuf, std::string outPath) {
+bool write_sig(const std::vector<u32> &chunks, std::string outPath) {
 	PakSigFile sigFile;
 	sigFile.encrypted_total_hash.resize(512);
-
-	const u32 chunkSize = 64 * 1024;
-	for (size_t start = 0; start < outBuf.size; start += chunkSize) {
-		size_t end = start + chunkSize;
-		if (end > outBuf.size) {
-			end = outBuf.size;
-		}
-
-		sigFile.chunks.emplace_back(CRC::MemCrc32(outBuf.buffer + start, end - start));
-	}
+	sigFile.chunks = chunks;
 
 	std::vector<u8> sigOutData;
 	DataBuffer sigOutBuf;
@@ -605,28 +624,43 @@ void write_sig(DataBuffer outBuf, std::string outPath) {
 
 	std::ofstream outPak(outPath, std::ios_base::binary);
 	outPak.write((char*)sigOutBuf.buffer, sigOutBuf.size);
+	outPak.close();
+	return !outPak.fail();
 }
-void save_file() {
+bool write_sig(DataBuffer outBuf, std::string outPath) {
+	return write_sig(PakSigFile::chunkCrcs(outBuf.buffer, outBuf.size), outPath);
+}
+
+bool Error_SaveFailed = false;
+std::string lastSaveError;
+
+//Returns false (and shows an error) if the pak or its sig couldn't be written. The changes stay
+//unsaved then.
+bool save_file() {
 	SongSerializationCtx ctx;
 	ctx.loading = false;
 	ctx.pak = &gCtx.currentPak->pak;
 
 	gCtx.currentPak->root.serialize(ctx);
 
-	std::vector<u8> outData;
-	DataBuffer outBuf;
-	outBuf.setupVector(outData);
-	outBuf.loading = false;
-	gCtx.currentPak->pak.serialize(outBuf);
-	outBuf.finalize();
-
 	std::string basePath = fs::path(gCtx.saveLocation).parent_path().string() + "/";
-	std::ofstream outPak(basePath + gCtx.currentPak->root.shortName + "_P.pak", std::ios_base::binary);
-	outPak.write((char*)outBuf.buffer, outBuf.size);
-	
-	write_sig(outBuf, basePath + gCtx.currentPak->root.shortName + "_P.sig");
+	std::string pakPath = basePath + gCtx.currentPak->root.shortName + "_P.pak";
+
+	std::vector<u32> chunks;
+	if (!gCtx.currentPak->pak.saveToFile(pakPath, PakSigFile::CHUNK_SIZE, chunks, lastSaveError)) {
+		Error_SaveFailed = true;
+		return false;
+	}
+
+	std::string sigPath = basePath + gCtx.currentPak->root.shortName + "_P.sig";
+	if (!write_sig(chunks, sigPath)) {
+		lastSaveError = "Couldn't write " + sigPath + ".";
+		Error_SaveFailed = true;
+		return false;
+	}
 	
 	unsavedChanges = false;
+	return true;
 }
 
 
@@ -660,35 +694,35 @@ void display_main_properties() {
 
 	if (ImGui::InputText("Short Name", &root.shortName, ImGuiInputTextFlags_CallbackCharFilter, ValidateShortName)) {
 		gCtx.saveLocation.clear(); //We clear the save location, since it needs to resolve to another file path.
-		unsavedChanges = true;
+		markEdited();
 	}
 
 	ImGui::SameLine();
 	HelpMarker("Short name can only contain alphanumeric characters and '_'. This name is used to uniquely identify your custom song.");
 
 	if(ImGui::InputText("Song Name", &root.songName))
-		unsavedChanges = true;
+		markEdited();
 	if(ImGui::InputText("Artist Name", &root.artistName))
-		unsavedChanges = true;
+		markEdited();
 	if(ImGui::InputScalar("BPM", ImGuiDataType_S32, &root.bpm))
-		unsavedChanges = true;
+		markEdited();
 	ChooseFuserEnum<FuserEnums::Key>("Key", root.songKey);
 	ChooseFuserEnum<FuserEnums::KeyMode>("Mode", root.keyMode);
 	ChooseFuserEnum<FuserEnums::Genre>("Genre", root.genre, false);
 	if(ImGui::InputScalar("Year", ImGuiDataType_S32, &root.year))
-		unsavedChanges = true;
+		markEdited();
 
 	if (ImGui::Checkbox("Is Stream Optimized?", &root.isStreamOptimized))
-		unsavedChanges = true;
+		markEdited();
 	ImGui::SameLine();
 	HelpMarker("When checked, the song will show up under the 'Stream Optimized' category in the game. This means it falls under a license that would make it safe for streaming/videos. Public domain songs, original songs (in-house), and some versions of the Creative Commons license fall under this category. If you're unsure, leave this unchecked.");
 } 
 //#include "stb_image_write.h"
 
 void update_texture(std::string filepath, AssetLink<IconFileAsset> icon) {
-	unsavedChanges = true;
+	markEdited(icon.data.file.e);
 	rgbcx::init();
-	auto texture = &std::get<Texture2D>(icon.data.file.e->getData().data.catagoryValues[0].value);
+	auto texture = &std::get<Texture2D>(icon.data.file.e->getData().data.catagoryValues[0].value());
 
 	for (int mip_index = 0; mip_index < texture->mips.size(); mip_index++) {
 		texture->mips[mip_index].width = (texture->mips[mip_index].width + 3) & ~3;
@@ -823,7 +857,7 @@ void display_mogg_settings(FusionFileAsset& fusionFile, size_t idx, HmxAudio::Pa
 				size_t fNameLen = fExt - fName;
 				std::wstring fNameW(fName, fNameLen);
 				std::string audioLabel(fNameW.begin(), fNameW.end());
-				auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
+				auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
 				if (replaceAudioLabel) {
 					for (auto&& file : asset.audio.audioFiles) {
 						if (file.fileType == "FusionPatchResource") {
@@ -836,7 +870,7 @@ void display_mogg_settings(FusionFileAsset& fusionFile, size_t idx, HmxAudio::Pa
 
 				mogg.fileData = std::move(outData);
 				fusionFile.playableMoggs[idx].oggData = std::move(fileData);
-				unsavedChanges = true;
+				markEdited(fusionFile.file.e);
 			}
 			else {
 				ImGui::OpenPopup("Ogg loading error");
@@ -848,13 +882,15 @@ void display_mogg_settings(FusionFileAsset& fusionFile, size_t idx, HmxAudio::Pa
 
 	display_playable_audio(fusionFile.playableMoggs[idx], addString);
 
-	ImGui::InputScalar("Sample Rate", ImGuiDataType_U32, &header.sample_rate);
+	if (ImGui::InputScalar("Sample Rate", ImGuiDataType_U32, &header.sample_rate)) {
+		markEdited(fusionFile.file.e);
+	}
 
 	ErrorModal("Ogg loading error", ("Failed to load ogg file:" + lastMoggError).c_str());
 }
 bool editAllMidiNote = false;
 
-void draw_visual_keymap_rect(hmx_fusion_nodes* drawZone, ImVec2& cursorScreenPos, ImVec2 winSize, int zoneIdx)
+void draw_visual_keymap_rect(hmx_fusion_nodes* drawZone, PakFile::PakEntry* fusionEntry, ImVec2& cursorScreenPos, ImVec2 winSize, int zoneIdx)
 {
 	static bool hasCornerSelected = false;
 	static int selectedCorner = 0;
@@ -891,6 +927,7 @@ void draw_visual_keymap_rect(hmx_fusion_nodes* drawZone, ImVec2& cursorScreenPos
 				ImVec2 mousePos = ImGui::GetMousePos();
 				int noteVal = std::clamp(((mousePos.x - (cursorScreenPos.x)) / winSize.x) * 127, 0.0f, 127.0f);
 				int velocityVal = std::clamp(127 - ((mousePos.y - (cursorScreenPos.y)) / winSize.y)*127, 0.0f, 127.0f);
+				markEdited(fusionEntry);
 				
 				switch (selectedCorner) {
 				case 0:
@@ -955,7 +992,7 @@ void draw_visual_keymap_rect(hmx_fusion_nodes* drawZone, ImVec2& cursorScreenPos
 }
 
 
-void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::PackageFile*> moggFiles, hmx_fusion_nodes* audioLabels, hmx_fusion_nodes* map) {
+void display_keyzone_settings(hmx_fusion_nodes* keyzone, PakFile::PakEntry* fusionEntry, std::vector<HmxAudio::PackageFile*> moggFiles, hmx_fusion_nodes* audioLabels, hmx_fusion_nodes* map) {
 	static bool keyzoneVisualEdit = false;
 
 	if (keyzoneVisualEdit) {
@@ -997,6 +1034,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 				if (ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
 					clickPos = ImGui::GetMousePos();
 					keyzone->getInt("root_note") = i;
+					markEdited(fusionEntry);
 				}
 			}
 		}
@@ -1022,6 +1060,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		if (noteClick) {
 			ImVec2 mousePos = ImGui::GetMousePos();
 			int noteVal = std::clamp(((mousePos.x - (cursorScreenPos.x)) / winSize.x) * 127, 0.0f, 127.0f);
+			markEdited(fusionEntry);
 			if (noteVal >= noteValStart) {
 				keyzone->getInt("min_note") = noteValStart;
 				keyzone->getInt("max_note") = noteVal;
@@ -1034,6 +1073,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		if (velClick) {
 			ImVec2 mousePos = ImGui::GetMousePos();
 			int velVal = std::clamp(127-((mousePos.y - (cursorScreenPos.y)) / winSize.y) * 127, 0.0f, 127.0f);
+			markEdited(fusionEntry);
 			if (velVal >= velStart) {
 				keyzone->getInt("min_velocity") = velStart;
 				keyzone->getInt("max_velocity") = velVal;
@@ -1056,11 +1096,11 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		for (auto& zone : map->children) {
 			if (zoneIdx != currentKeyzone) {
 				hmx_fusion_nodes* drawZone = std::get<hmx_fusion_nodes*>(zone.value);
-				draw_visual_keymap_rect(drawZone, cursorScreenPos, winSize, zoneIdx);
+				draw_visual_keymap_rect(drawZone, fusionEntry, cursorScreenPos, winSize, zoneIdx);
 			}
 			zoneIdx++;
 		}
-		draw_visual_keymap_rect(keyzone, cursorScreenPos, winSize, currentKeyzone);
+		draw_visual_keymap_rect(keyzone, fusionEntry, cursorScreenPos, winSize, currentKeyzone);
 		ImGui::EndChild();
 		ImGui::End();
 	}
@@ -1068,11 +1108,11 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 	int itemWidth = 300;
 	ImGui::PushItemWidth(itemWidth);
 	if(ImGui::InputText("Keymap Label", &keyzone->getString("zone_label")))
-		unsavedChanges = true;
+		markEdited(fusionEntry);
 	bool unp = keyzone->getInt("unpitched") == 1;
 	bool unp_changed = ImGui::Checkbox("Unpitched", &unp);
 	if (unp_changed) {
-		unsavedChanges = true;
+		markEdited(fusionEntry);
 		if (unp)
 			keyzone->getInt("unpitched") = 1;
 		else
@@ -1086,12 +1126,13 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		label.key = "orig_tempo_sync";
 		label.value = 1;
 		ts.children.insert(ts.children.begin(), label);
+		markEdited(fusionEntry);
 	}
 	bool orig_tempo_sync = ts.getInt("orig_tempo_sync") == 1;
 	bool natp = ts.getInt("maintain_formant") == 1;
 	bool natp_changed = ImGui::Checkbox("Natural Pitching", &natp);
 	if (natp_changed) {
-		unsavedChanges = true;
+		markEdited(fusionEntry);
 		if (natp)
 			ts.getInt("maintain_formant") = 1;
 		else
@@ -1119,7 +1160,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 			if (ImGui::Selectable((std::to_string(i) +" - "+ audioLabels->getString(fileNames[i])).c_str(), is_selected))
 			{
 				selectedAudioFile = i;
-				keyzone->getString("sample_path") = "C:/"+fileNames[i]+".mogg";
+				setEdited(fusionEntry, keyzone->getString("sample_path"), "C:/" + fileNames[i] + ".mogg");
 			}
 			if (is_selected)
 			{
@@ -1157,7 +1198,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		for (int i = 0; i < 4; i++) {
 			if (ImGui::Selectable(options[i])) {
 				keyzone->getInt("keymap_preset") = i;
-				unsavedChanges = true;
+				markEdited(fusionEntry);
 				if (i == 0) {
 					keyzone->getInt("min_note") = kpmaj.min;
 					keyzone->getInt("max_note") = kpmaj.max;
@@ -1193,7 +1234,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		bool sng = keyzone->getInt("singleton") == 1;
 		bool sng_changed = ImGui::Checkbox("Singleton", &sng);
 		if (sng_changed) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			if (sng)
 				keyzone->getInt("singleton") = 1;
 			else
@@ -1205,7 +1246,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		bool mt = ts.getInt("maintain_time") == 1;
 		bool mt_changed = ImGui::Checkbox("Maintain Time", &mt);
 		if (mt_changed) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			if (mt)
 				ts.getInt("maintain_time") = 1;
 			else
@@ -1217,7 +1258,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		bool st = ts.getInt("sync_tempo") == 1;
 		bool st_changed = ImGui::Checkbox("Sync Tempo", &st);
 		if (st_changed) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			if (st)
 				ts.getInt("sync_tempo") = 1;
 			else
@@ -1232,7 +1273,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		ImGui::SameLine();
 		HelpMarker("If unchecked, will allow changing orig_tempo to a different value than the song's bpm, and the game will timestretch accordingly");
 		if (ots_changed) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			if (orig_tempo_sync) {
 				ts.getInt("orig_tempo_sync") = 1;
 			}
@@ -1242,14 +1283,14 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		}
 		if (!orig_tempo_sync) {
 			if (ImGui::InputScalar("Original Tempo", ImGuiDataType_U32, &ts.getInt("orig_tempo"))) {
-				unsavedChanges = true;
+				markEdited(fusionEntry);
 			}
 		}
 
 		bool vel2vol = keyzone->getInt("velocity_to_volume") == 1;
 		bool vel2vol_changed = ImGui::Checkbox("Velocity to Volume", &vel2vol);
 		if (vel2vol_changed) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			if (vel2vol)
 				keyzone->getInt("velocity_to_volume") = 1;
 			else
@@ -1261,20 +1302,17 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		float& kzvol = keyzone->getFloat("volume");
 		ImGui::PushItemWidth(150);
 		if (ImGui::InputFloat("Volume", &kzvol, 0.0f, 0.0f, "%.2f"))
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 		ImGui::PopItemWidth();
 		ImGui::SameLine();
 		HelpMarker("The volume of the keyzone. 0 means it's the same volume as the imported audio, negative values make it quieter, positive values make it louder. This is relative to the gain for the disc/riser.");
 		ImGui::SameLine();
 
 		float& kzpan = keyzone->getNode("pan").getFloat("position");
-		if (kzpan < -1)
-			kzpan = -1;
-		else if (kzpan > 1)
-			kzpan = 1;
+		setEdited(fusionEntry, kzpan, std::clamp(kzpan, -1.0f, 1.0f));
 		ImGui::PushItemWidth(150);
 		if (ImGui::InputFloat("Pan", &kzpan, 0.0f, 0.0f, "%.2f"))
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 		ImGui::PopItemWidth();
 		ImGui::SameLine();
 		HelpMarker("Panning of the keyzone. -1 is left, 1 is right, 0 is center");
@@ -1286,7 +1324,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		ImGui::PushItemWidth(itemWidth);
 
 		if (ImGui::InputScalar("Map - Min Note", ImGuiDataType_U32, &keyzone->getInt("min_note"))) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			if (editAllMidiNote) {
@@ -1300,7 +1338,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		HelpMarker("The lowest midi note that the selected sample will play.");
 
 		if (ImGui::InputScalar("Map - Highest Note", ImGuiDataType_U32, &keyzone->getInt("max_note"))) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			if (editAllMidiNote) {
@@ -1313,7 +1351,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		HelpMarker("The highest midi note that the selected sample will play.");
 
 		if (ImGui::InputScalar("Map - Root Note", ImGuiDataType_U32, &keyzone->getInt("root_note"))) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			if (editAllMidiNote) {
@@ -1326,7 +1364,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		HelpMarker("The note at which that the selected sample will play at its original pitch.");
 
 		if (ImGui::InputScalar("Map - Min Velocity", ImGuiDataType_U32, &minvel)) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			if (fcsc_cfg.usePercentVelocity)
@@ -1338,7 +1376,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		HelpMarker("The lowest midi note velocity at which the selected sample will play.");
 
 		if (ImGui::InputScalar("Map - Max Velocity", ImGuiDataType_U32, &maxvel)) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			if (fcsc_cfg.usePercentVelocity)
@@ -1350,7 +1388,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		HelpMarker("The highest midi note velocity at which the selected sample will play.");
 
 		if (ImGui::InputScalar("Audio - Start Offset", ImGuiDataType_S32, &keyzone->getInt("start_offset_frame"))) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			keyzone->getInt("start_offset_frame") = std::clamp(keyzone->getInt("start_offset_frame"), -1, INT_MAX);
@@ -1359,7 +1397,7 @@ void display_keyzone_settings(hmx_fusion_nodes* keyzone, std::vector<HmxAudio::P
 		HelpMarker("The offset, in samples, that the audio will start playing from.");
 
 		if (ImGui::InputScalar("Audio - End Offset", ImGuiDataType_S32, &keyzone->getInt("end_offset_frame"))) {
-			unsavedChanges = true;
+			markEdited(fusionEntry);
 			selectedPreset = 3;
 			keyzone->getInt("keymap_preset") = 3;
 			keyzone->getInt("end_offset_frame") = std::clamp(keyzone->getInt("end_offset_frame"), -1, INT_MAX);
@@ -1405,7 +1443,8 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 	if (ImGui::Button("Import##FUSIONIMPORT", btnHolderSize)) {
 		auto file = OpenFile("Fusion Text File (.fusion)\0*.fusion\0");
 		if (file) {
-			unsavedChanges = true;
+			auto&& fusionFile = isRiser ? celData.songTransitionFile.data.majorAssets[0].data.fusionFile.data : celData.majorAssets[0].data.fusionFile.data;
+			markEdited(fusionFile.file.e);
 			for (auto&& f : asset.audio.audioFiles) {
 				if (f.fileType == "FusionPatchResource") {
 					std::ifstream infile(*file, std::ios_base::binary);
@@ -1439,7 +1478,6 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 		try {
 			auto file = OpenFile("MIDI (.mid)\0*.mid\0Harmonix Midi Resource File (.mid_pc)\0*.mid_pc\0");
 			if (file) {
-				unsavedChanges = true;
 				AssetLink<MidiSongAsset>* midiSong = nullptr;
 				if (maj) {
 					midiSong = isRiser ? &celData.songTransitionFile.data.majorAssets[0] : &celData.majorAssets[0];
@@ -1449,7 +1487,7 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 				}
 
 				auto&& midi_file = midiSong->data.midiFile.data;
-				auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value);
+				auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value());
 
 				HmxAudio::PackageFile::MidiFileResource mfr;
 
@@ -1479,6 +1517,7 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 
 					}
 					midiAsset.audio.audioFiles[0].resourceHeader = std::move(mfr);
+					markEdited(midi_file.file.e);
 					midi_error = false;
 					mfrError = "";
 				}
@@ -1538,7 +1577,7 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 				}
 
 				auto&& midi_file = midiSong->data.midiFile.data;
-				auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value);
+				auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value());
 				std::get<HmxAudio::PackageFile::MidiFileResource>(midiAsset.audio.audioFiles[0].resourceHeader).MFR_to_midi(*file);
 			}
 		}
@@ -1551,20 +1590,20 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 		bool tickLengthAdvanced = celData.tickLengthAdvanced;
 		if (disc_advanced) {
 			if(ImGui::Checkbox("Advanced Length Input", &celData.tickLengthAdvanced))
-				unsavedChanges = true;
+				markEdited();
 			ImGui::SameLine();
 			HelpMarker("Will allow the length in ticks for the custom to loop to be set to any value. Calculate using the formula \"Length = 480 * beats\". Default is 61440, which is the length of 32 bars in midi ticks.");
 		}
 		if (tickLengthAdvanced) {
 			if(ImGui::InputInt("Tick Length", &celData.tickLength, 0, 0))
-				unsavedChanges = true;
+				markEdited();
 		}
 		else {
 			const char* options[] = { "8 bars", "16 bars","32 bars","64 bars" };
 			if (ImGui::BeginCombo("Disc Length", options[celData.selectedTickLength])) {
 				for (int i = 0; i < 4; i++) {
 					if (ImGui::Selectable(options[i])) {
-						unsavedChanges = true;
+						markEdited();
 						celData.selectedTickLength = i;
 						if (i == 0) {
 							celData.tickLength = 15360;
@@ -1584,11 +1623,11 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 			}
 		}
 		if (ImGui::Button("Update MIDI length")) {
-			unsavedChanges = true;
 			if (disc_midi_maj_single == 1) {
 				AssetLink<MidiSongAsset>& midiSong = celData.majorAssets[0];
 				auto&& midi_file = midiSong.data.midiFile.data;
-				auto&& midiAsset = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value).audio.audioFiles[0].resourceHeader);
+				auto&& midiAsset = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value()).audio.audioFiles[0].resourceHeader);
+				markEdited(midi_file.file.e);
 				midiAsset.final_tick = celData.tickLength;
 				midiAsset.final_tick_minus_one = celData.tickLength - 1;
 				midiAsset.last_track_final_tick = celData.tickLength;
@@ -1609,7 +1648,8 @@ static void display_fusionmidisettings(HmxAssetFile& asset, CelData& celData, Hm
 			if (disc_midi_min_single == 1) {
 				AssetLink<MidiSongAsset>& midiSong = celData.minorAssets[0];
 				auto&& midi_file = midiSong.data.midiFile.data;
-				auto&& midiAsset = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value).audio.audioFiles[0].resourceHeader);
+				auto&& midiAsset = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value()).audio.audioFiles[0].resourceHeader);
+				markEdited(midi_file.file.e);
 				midiAsset.final_tick = celData.tickLength;
 				midiAsset.final_tick_minus_one = celData.tickLength - 1;
 				midiAsset.last_track_final_tick = celData.tickLength;
@@ -1777,18 +1817,19 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 			alnodes->children.emplace_back(audiolabel);
 		}
 		fusion.nodes.children.insert(fusion.nodes.children.begin(), audiolabelholder);
+		markEdited(fusionFile.file.e);
 		AssetLink<MidiSongAsset>* midiSong = nullptr;
 		{
 			midiSong = &celData.majorAssets[0];
 			auto&& midi_file = midiSong->data.midiFile.data;
-			auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value);
+			auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value());
 			auto& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(midiAsset.audio.audioFiles[0].resourceHeader);
 		}
 
 		{
 			midiSong = &celData.minorAssets[0];
 			auto&& midi_file = midiSong->data.midiFile.data;
-			auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value);
+			auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value());
 			auto& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(midiAsset.audio.audioFiles[0].resourceHeader);
 		}
 		
@@ -1804,7 +1845,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 	float& trackGain = std::get<hmx_fusion_nodes*>(fusion.nodes.getNode("presets").children[0].value)->getFloat("volume");
 	ImGui::PushItemWidth(150);
 	if (ImGui::InputFloat(gainInputLabel.c_str(), &trackGain, 0.0f, 0.0f, "%.2f"))
-		unsavedChanges = true;
+		markEdited(fusionFile.file.e);
 	ImGui::PopItemWidth();
 	ImGui::SameLine();
 
@@ -1814,14 +1855,14 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		ImGui::PushItemWidth(150);
 		std::string& layerMode = std::get<hmx_fusion_nodes*>(fusion.nodes.getNode("presets").children[0].value)->getString("layer_select_mode");
 		if (std::find(layer_select_modes.begin(), layer_select_modes.end(), layerMode) == layer_select_modes.end())
-			layerMode = "layers";
+			setEdited(fusionFile.file.e, layerMode, "layers");
 		if (ImGui::BeginCombo("Layering Mode", layerMode.c_str())) {
 			for (int i = 0; i < layer_select_modes.size(); ++i)
 			{
 				bool is_selected = layerMode == layer_select_modes[i];
 				if (ImGui::Selectable(layer_select_modes[i].c_str(), is_selected))
 				{
-					std::get<hmx_fusion_nodes*>(fusion.nodes.getNode("presets").children[0].value)->getString("layer_select_mode") = layer_select_modes[i];
+					setEdited(fusionFile.file.e, layerMode, layer_select_modes[i]);
 				}
 				if (is_selected)
 				{
@@ -1845,7 +1886,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 			ImGui::BeginChild("Buttons", ImVec2(420, 25));
 			if (ImGui::Button("Yes", ImVec2(120, 0)))
 			{
-				unsavedChanges = true;
+				markEdited(fusionFile.file.e);
 				ImGui::CloseCurrentPopup();
 
 				currentAudioFile = 0;
@@ -1958,7 +1999,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 			ImGui::BeginChild("Buttons", ImVec2(420, 25));
 			if (ImGui::Button("Yes", ImVec2(120, 0)))
 			{
-				unsavedChanges = true;
+				markEdited(fusionFile.file.e);
 				ImGui::CloseCurrentPopup();
 				fusion.nodes.getInt("edit_advanced") = 1;
 				advanced = true;
@@ -2002,6 +2043,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 					label.key = moggName(moggFiles[i]->fileName);
 					label.value = moggName(moggFiles[i]->fileName);
 					audiolabels.children.push_back(label);
+					markEdited(fusionFile.file.e);
 				}
 				ImGui::Text(audiolabels.getString(moggName(moggFiles[i]->fileName)).c_str());
 
@@ -2010,12 +2052,12 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		}
 		ImGui::EndChild();
 		if (ImGui::Button("Add Audio File")) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			addAudio = true;
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Remove Audio File") && moggFiles.size() != 1) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			removeAudio = true;
 		}
 		ImGui::EndChild();
@@ -2024,7 +2066,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		ImGui::BeginChild("AudioSettings", ImVec2((aRegion.x / 3) * 2, (aRegion.y / 3)));
 		
 		if(ImGui::InputText("Audio File Label", &audiolabels.getString(moggName(moggFiles[currentAudioFile]->fileName))))
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 		ImGui::Checkbox("Replace label on .ogg load", &replaceAudioLabel);
 		display_mogg_settings(fusionFile, currentAudioFile, *moggFiles[currentAudioFile], "");
 		ImGui::EndChild();
@@ -2060,7 +2102,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 
 		ImGui::EndChild();
 		if (ImGui::Button("Add Keyzone")) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			map.children.emplace_back(map.children[currentKeyzone]);
 			std::string str = hmx_fusion_parser::outputData(map);
 			std::vector<std::uint8_t> vec(str.begin(), str.end());
@@ -2070,7 +2112,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Remove Keyzone") && map.children.size() != 1) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			int mapToErase = currentKeyzone;
 			if (currentKeyzone == map.children.size() - 1)
 				currentKeyzone--;
@@ -2082,7 +2124,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		ImGui::SameLine();
 
 		ImGui::BeginChild("KeymapSettings", ImVec2((aRegion.x / 3) * 2, ImGui::GetContentRegionAvail().y));
-		display_keyzone_settings(std::get<hmx_fusion_nodes*>(map.children[currentKeyzone].value), moggFiles, &audiolabels, &map);
+		display_keyzone_settings(std::get<hmx_fusion_nodes*>(map.children[currentKeyzone].value), fusionFile.file.e, moggFiles, &audiolabels, &map);
 		ImGui::EndChild();
 
 		ImGui::EndChild();
@@ -2180,7 +2222,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		duplicate_changed = ImGui::Checkbox("Duplicate Audio?", &duplicate_moggs);
 
 		if (duplicate_changed) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			if (duplicate_moggs) {
 				if (moggFiles.size() == 2) {
 					asset.audio.audioFiles.erase(asset.audio.audioFiles.begin() + 1);
@@ -2242,7 +2284,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		bool unp = nodes[0]->getInt("unpitched") == 1;
 		bool unp_changed = ImGui::Checkbox("Unpitched", &unp);
 		if (unp_changed) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			if (unp) {
 				nodes[0]->getInt("unpitched") = 1;
 				nodes[1]->getInt("unpitched") = 1;
@@ -2253,13 +2295,8 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 			}
 		}
 
-		if (isRiser) {
-			nodes[0]->getInt("singleton") = 0;
-			nodes[1]->getInt("singleton") = 0;
-		}
-		else {
-			nodes[0]->getInt("singleton") = 1;
-			nodes[1]->getInt("singleton") = 1;
+		for (auto node : nodes) {
+			setEdited(fusionFile.file.e, node->getInt("singleton"), isRiser ? 0 : 1);
 		}
 
 		auto&& ts = nodes[0]->getNode("timestretch_settings");
@@ -2267,7 +2304,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		bool natp = ts.getInt("maintain_formant") == 1;
 		bool natp_changed = ImGui::Checkbox("Natural Pitching", &natp);
 		if (natp_changed) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			if (natp) {
 				ts.getInt("maintain_formant") = 1;
 				ts2.getInt("maintain_formant") = 1;
@@ -2282,6 +2319,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 			label.key = "orig_tempo_sync";
 			label.value = 1;
 			ts.children.insert(ts.children.begin(), label);
+			markEdited(fusionFile.file.e);
 		}
 
 		bool orig_tempo_sync = ts.getInt("orig_tempo_sync") == 1;
@@ -2289,7 +2327,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		ImGui::SameLine();
 		HelpMarker("If unchecked, will allow changing orig_tempo to a different value than the song's bpm, and the game will timestretch accordingly");
 		if (ots_changed) {
-			unsavedChanges = true;
+			markEdited(fusionFile.file.e);
 			if (orig_tempo_sync) {
 				ts.getInt("orig_tempo_sync") = 1;
 			}
@@ -2300,7 +2338,7 @@ static void display_cel_audio_options(CelData& celData, HmxAssetFile& asset, std
 		if (!orig_tempo_sync) {
 			if (ImGui::InputScalar("Original Tempo", ImGuiDataType_U32, &ts.getInt("orig_tempo"))) {
 				ts2.getInt("orig_tempo") = ts.getInt("orig_tempo");
-				unsavedChanges = true;
+				markEdited(fusionFile.file.e);
 			}
 		}
 
@@ -2333,7 +2371,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 	AssetLink<MidiSongAsset>* midiSong = nullptr;
 	midiSong = minor ? &celData.minorAssets[0] : &celData.majorAssets[0];
 	auto&& midi_file = midiSong->data.midiFile.data;
-	auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value);
+	auto&& midiAsset = std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value());
 	auto& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(midiAsset.audio.audioFiles[0].resourceHeader);
 
 	ImGui::BeginChild("ChordTableHolder", ImVec2((windowSize.x / 3) - 15, oggWindowSize - 240));
@@ -2412,7 +2450,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 									if (ImGui::Selectable(chordNamesMinorMajor[k], is_selected))
 									{
 										selectedChordIndex = k;
-										mfr.chords[i].name = chordNamesMinorMajor[selectedChordIndex];
+										setEdited(midi_file.file.e, mfr.chords[i].name, chordNamesMinorMajor[selectedChordIndex]);
 									}
 									if (is_selected)
 									{
@@ -2442,7 +2480,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 									if (ImGui::Selectable(chordNamesMajorMinor[k], is_selected))
 									{
 										selectedChordIndex = k;
-										mfr.chords[i].name = chordNamesMajorMinor[selectedChordIndex];
+										setEdited(midi_file.file.e, mfr.chords[i].name, chordNamesMajorMinor[selectedChordIndex]);
 									}
 									if (is_selected)
 									{
@@ -2456,7 +2494,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 				}
 				else {
 					if (ImGui::Combo(("##ChordCombo" + std::to_string(i)).c_str(), &selectedChordIndex, chordNamesInterleaved, IM_ARRAYSIZE(chordNamesInterleaved))) {
-						unsavedChanges = true;
+						markEdited(midi_file.file.e);
 						mfr.chords[i].name = chordNamesInterleaved[selectedChordIndex];
 					}
 				}
@@ -2477,7 +2515,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 		chordInputTicks = chordInput * 480;
 	}
 	if (ImGui::Button("Add Chord")) {
-		unsavedChanges = true;
+		markEdited(midi_file.file.e);
 		chordInput = std::round(std::clamp(chordInput, 0.0F, celData.tickLength / 480.0F) * 100) / 100;
 		chordInputTicks = chordInput * 480;
 		if (mfr.chords.size() > 0) {
@@ -2514,7 +2552,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 	}
 	ImGui::SameLine();
 	if (ImGui::Button("Update Chord Beat") && mfr.chords.size() > 0) {
-		unsavedChanges = true;
+		markEdited(midi_file.file.e);
 		chordInput = std::round(std::clamp(chordInput, 0.0F, celData.tickLength / 480.0F) * 100) / 100;
 		chordInputTicks = chordInput * 480;
 		if (mfr.chords.size() == 1) {
@@ -2542,7 +2580,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 	}
 	ImGui::SameLine();
 	if (ImGui::Button("Remove Chord") && mfr.chords.size() > 0) {
-		unsavedChanges = true;
+		markEdited(midi_file.file.e);
 		int chordToErase = curChord;
 		if (curChord == mfr.chords.size() - 1) {
 			curChord--;
@@ -2578,7 +2616,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 		ImGui::BeginChild("Buttons", ImVec2(420, 25));
 		if (ImGui::Button("Yes", ImVec2(120, 0)))
 		{
-			unsavedChanges = true;
+			markEdited(midi_file.file.e);
 			mfr.chords.clear();
 			curChord = -1;
 			ImGui::CloseCurrentPopup();
@@ -2603,7 +2641,7 @@ static void display_chord_edit(CelData& celData, ImVec2& windowSize, float oggWi
 		ImGui::BeginChild("Buttons", ImVec2(420, 25));
 		if (ImGui::Button("Yes", ImVec2(120, 0)))
 		{
-			unsavedChanges = true;
+			markEdited(midi_file.file.e);
 			if (copiedChordsMinor == minor)
 				mfr.chords = chordCopyBuffer;
 			else
@@ -2631,22 +2669,23 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 	{
 		AssetLink<MidiSongAsset>* midiSong = &celData.minorAssets[0];
 		auto&& midi_file = midiSong->data.midiFile.data;
-		auto&& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value).audio.audioFiles[0].resourceHeader);
-		mfr.minor = true;
+		auto&& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value()).audio.audioFiles[0].resourceHeader);
+		setEdited(midi_file.file.e, mfr.minor, true);
+		//Only cached for the UI, it isn't part of the file
 		mfr.is_single_note = mfr.MFR_is_single_note();
 		disc_midi_min_single = mfr.is_single_note;
 	}
 	{
 		AssetLink<MidiSongAsset>* midiSong = &celData.majorAssets[0];
 		auto&& midi_file = midiSong->data.midiFile.data;
-		auto&& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value).audio.audioFiles[0].resourceHeader);
+		auto&& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(std::get<HmxAssetFile>(midi_file.file.e->getData().data.catagoryValues[0].value()).audio.audioFiles[0].resourceHeader);
 		mfr.is_single_note = mfr.MFR_is_single_note();
 		disc_midi_maj_single = mfr.is_single_note;
 	}
 	ChooseFuserEnum<FuserEnums::Instrument>("Instrument", celData.instrument, false);
 	auto&& fusionFile = celData.majorAssets[0].data.fusionFile.data;
 
-	auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
+	auto&& asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
 	//auto &&mogg = asset.audio.audioFiles[0];
 
 	HmxAudio::PackageFile* fusionPackageFile = nullptr;
@@ -2675,6 +2714,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 			label.key = "edit_advanced";
 			label.value = 0;
 			fusion.nodes.children.insert(fusion.nodes.children.begin(), label);
+			markEdited(fusionFile.file.e);
 			disc_advanced = false;
 		}
 		else {
@@ -2701,6 +2741,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 				}
 				else { label.value = "Keyzone " + std::to_string(mapidx); }
 				nodes->children.insert(nodes->children.begin(), label);
+				markEdited(fusionFile.file.e);
 			}
 			if (nodes->getChild("keymap_preset") == nullptr) {
 				hmx_fusion_node kmpreset;
@@ -2745,6 +2786,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 
 
 				nodes->children.insert(nodes->children.begin(), kmpreset);
+				markEdited(fusionFile.file.e);
 			}
 			mapidx++;
 		}
@@ -2755,7 +2797,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 	// Riser Moggs
 
 	auto&& fusionFileRiser = celData.songTransitionFile.data.majorAssets[0].data.fusionFile.data;
-	auto&& assetRiser = std::get<HmxAssetFile>(fusionFileRiser.file.e->getData().data.catagoryValues[0].value);
+	auto&& assetRiser = std::get<HmxAssetFile>(fusionFileRiser.file.e->getData().data.catagoryValues[0].value());
 	//auto &&mogg = asset.audio.audioFiles[0];
 
 	HmxAudio::PackageFile* fusionPackageFileRiser = nullptr;
@@ -2782,6 +2824,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 			label.key = "edit_advanced";
 			label.value = 0;
 			fusionRiser.nodes.children.insert(fusionRiser.nodes.children.begin(), label);
+			markEdited(fusionFileRiser.file.e);
 			rise_advanced = false;
 		}
 		else {
@@ -2805,6 +2848,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 					label.value = "UNKNOWN";
 				}
 				nodesRiser->children.insert(nodesRiser->children.begin(), label);
+				markEdited(fusionFileRiser.file.e);
 			}
 			if (nodesRiser->getChild("keymap_preset") == nullptr) {
 				hmx_fusion_node kmpreset;
@@ -2846,6 +2890,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 				}
 
 				nodesRiser->children.insert(nodesRiser->children.begin(), kmpreset);
+				markEdited(fusionFileRiser.file.e);
 			}
 			mapidx++;
 		}
@@ -2902,7 +2947,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 						pickupInput = std::round(std::clamp(pickupInput, 0.0F, 128.0F) * 100) / 100;
 					}
 					if (ImGui::Button("Add Pickup")) {
-						unsavedChanges = true;
+						markEdited(celData.file.e);
 						pickupInput = std::round(std::clamp(pickupInput, 0.0F, 128.0F) * 100) / 100;
 
 						if (celData.pickupArray->values.size() > 0) {
@@ -2919,12 +2964,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 								std::sort(pickups.begin(), pickups.end());
 								auto last = std::unique(pickups.begin(), pickups.end());
 								pickups.erase(last, pickups.end());
-								celData.pickupArray->values.clear();
-								for (int i = 0; i < pickups.size(); i++) {
-									celData.pickupArray->values.emplace_back(new IPropertyValue);
-									celData.pickupArray->values[i]->v = asset_helper::createPropertyValue("FloatProperty");
-									std::get<PrimitiveProperty<float>>(celData.pickupArray->values[i]->v).data = pickups[i];
-								}
+								celData.setPickups(pickups);
 								auto it2 = std::find(pickups.begin(), pickups.end(), pickupInput);
 								if (it2 != pickups.end()) {
 									curPickup = std::distance(pickups.begin(), it2);
@@ -2932,9 +2972,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 							}
 						}
 						else {
-							celData.pickupArray->values.emplace_back(new IPropertyValue);
-							celData.pickupArray->values[0]->v = asset_helper::createPropertyValue("FloatProperty");
-							std::get<PrimitiveProperty<float>>(celData.pickupArray->values[0]->v).data = pickupInput;
+							celData.setPickups({ pickupInput });
 							curPickup = 0;
 						}
 
@@ -2942,7 +2980,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 					}
 					ImGui::SameLine();
 					if (ImGui::Button("Update Pickup") && celData.pickupArray->values.size() > 0) {
-						unsavedChanges = true;
+						markEdited(celData.file.e);
 						pickupInput = std::round(std::clamp(pickupInput, 0.0F, 128.0F) * 100) / 100;
 						if (celData.pickupArray->values.size() == 1) {
 							std::get<PrimitiveProperty<float>>(celData.pickupArray->values[curPickup]->v).data = pickupInput;
@@ -2959,12 +2997,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 								std::sort(pickups.begin(), pickups.end());
 								auto last = std::unique(pickups.begin(), pickups.end());
 								pickups.erase(last, pickups.end());
-								celData.pickupArray->values.clear();
-								for (int i = 0; i < pickups.size(); i++) {
-									celData.pickupArray->values.emplace_back(new IPropertyValue);
-									celData.pickupArray->values[i]->v = asset_helper::createPropertyValue("FloatProperty");
-									std::get<PrimitiveProperty<float>>(celData.pickupArray->values[i]->v).data = pickups[i];
-								}
+								celData.setPickups(pickups);
 								auto it2 = std::find(pickups.begin(), pickups.end(), pickupInput);
 								if (it2 != pickups.end()) {
 									curPickup = std::distance(pickups.begin(), it2);
@@ -2975,12 +3008,12 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 					}
 					ImGui::SameLine();
 					if (ImGui::Button("Remove Pickup") && celData.pickupArray->values.size() > 0) {
-						unsavedChanges = true;
+						markEdited(celData.file.e);
 						int pickupToErase = curPickup;
 						if (curPickup == celData.pickupArray->values.size() - 1) {
 							curPickup--;
 						}
-						celData.pickupArray->values.erase(celData.pickupArray->values.begin() + pickupToErase);
+						celData.removePickup(pickupToErase);
 						if (celData.pickupArray->values.size() > 0) {
 							pickupInput = std::get<PrimitiveProperty<float>>(celData.pickupArray->values[curPickup]->v).data;
 						}
@@ -3003,8 +3036,8 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 						ImGui::BeginChild("Buttons", ImVec2(420, 25));
 						if (ImGui::Button("Yes", ImVec2(120, 0)))
 						{
-							unsavedChanges = true;
-							celData.pickupArray->values.clear();
+							markEdited(celData.file.e);
+							celData.setPickups({});
 							curPickup = -1;
 							ImGui::CloseCurrentPopup();
 						}
@@ -3058,7 +3091,7 @@ static void display_cel_data(CelData& celData, FuserEnums::KeyMode::Value curren
 	bool allUnpitchedChanged = ImGui::Checkbox("Track has no key?", &allUnpitched);
 
 	if (allUnpitchedChanged) {
-		unsavedChanges = true;
+		markEdited();
 		if (allUnpitched) {
 			celData.allUnpitched = true;
 			celData.songTransitionFile.data.allUnpitched = true;
@@ -3096,14 +3129,13 @@ void custom_song_creator_update(size_t width, size_t height) {
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
 	ImGui::Begin((windowTitle+"###FCSC_TITLE").c_str(), nullptr, window_flags); 
 	if (filenameArg) {
-		std::ifstream infile(filenameArgPath, std::ios_base::binary);
-		std::vector<u8> fileData = std::vector<u8>(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
-
-		DataBuffer dataBuf;
-		dataBuf.setupVector(fileData);
-		load_file(std::move(dataBuf));
-
-		gCtx.saveLocation = filenameArgPath;
+		if (auto mapped = MappedFile::open(filenameArgPath)) {
+			DataBuffer dataBuf;
+			dataBuf.setupMapped(mapped);
+			if (load_file(std::move(dataBuf))) {
+				gCtx.saveLocation = filenameArgPath;
+			}
+		}
 		filenameArg = false;
 	}
 	if (ImGui::BeginMenuBar())
@@ -3196,9 +3228,9 @@ void custom_song_creator_update(size_t width, size_t height) {
 				save_file = "Fuser Midi File (*.midi_pc)\0.midi_pc\0";
 				ext = "midi_pc";
 				getData = [](const Asset& asset) {
-					auto&& midiAsset = std::get<HmxAssetFile>(asset.data.catagoryValues[0].value);
+					auto&& midiAsset = std::get<HmxAssetFile>(asset.data.catagoryValues[0].value());
 					auto&& fileData = midiAsset.audio.audioFiles[0].fileData;
-					return fileData;
+					return std::vector<u8>(fileData.begin(), fileData.end());
 					};
 			}
 
@@ -3230,7 +3262,7 @@ void custom_song_creator_update(size_t width, size_t height) {
 				save_file = "Fuser Fusion File (*.fusion)\0.fusion\0";
 				ext = "fusion";
 				getData = [](const Asset& asset) {
-					auto&& assetFile = std::get<HmxAssetFile>(asset.data.catagoryValues[0].value);
+					auto&& assetFile = std::get<HmxAssetFile>(asset.data.catagoryValues[0].value());
 
 					for (auto&& f : assetFile.audio.audioFiles) {
 						if (f.fileType == "FusionPatchResource") {
@@ -3389,14 +3421,13 @@ void custom_song_creator_update(size_t width, size_t height) {
 	if (do_open_2) {
 		auto file = OpenFile("Fuser Custom Song (*.pak)\0*.pak\0");
 		if (file) {
-			std::ifstream infile(*file, std::ios_base::binary);
-			std::vector<u8> fileData = std::vector<u8>(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
-
-			DataBuffer dataBuf;
-			dataBuf.setupVector(fileData);
-			load_file(std::move(dataBuf));
-
-			gCtx.saveLocation = *file;
+			if (auto mapped = MappedFile::open(*file)) {
+				DataBuffer dataBuf;
+				dataBuf.setupMapped(mapped);
+				if (load_file(std::move(dataBuf))) {
+					gCtx.saveLocation = *file;
+				}
+			}
 		}
 	}
 
@@ -3450,6 +3481,18 @@ void custom_song_creator_update(size_t width, size_t height) {
 
 		ImGui::Text("To open an existing custom song, use File -> Open.");
 	}
+	if (Error_LoadFailed) {
+		ImGui::OpenPopup("Pak loading error");
+		Error_LoadFailed = false;
+	}
+	ErrorModal("Pak loading error", ("Failed to load pak file: " + lastLoadError).c_str());
+
+	if (Error_SaveFailed) {
+		ImGui::OpenPopup("Pak saving error");
+		Error_SaveFailed = false;
+	}
+	ErrorModal("Pak saving error", ("Failed to save pak file: " + lastSaveError).c_str());
+
 	if (closePressed) {
 		ImGui::OpenPopup("Exit without saving?");
 	}
@@ -3468,7 +3511,14 @@ void custom_song_creator_update(size_t width, size_t height) {
 			else {
 				select_save_location();
 			}
-			DestroyWindow(G_hwnd);
+
+			//Stay open if it didn't save, so the error shows and nothing is lost
+			if (!unsavedChanges) {
+				DestroyWindow(G_hwnd);
+			}
+			else {
+				ImGui::CloseCurrentPopup();
+			}
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Exit Without Saving", ImVec2(200, 0)))
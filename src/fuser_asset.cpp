@@ -108,7 +108,8 @@ void display_property(asset_helper::PropertyValue& v);
 
 void display_property(StringRef32& v) {
 	if (v.str.empty()) {
-		ImGui::Text("%s", v.getString(dispCtx.header).c_str());
+		auto str = v.getString(dispCtx.header);
+		ImGui::Text("%.*s", (int)str.size(), str.data());
 	}
 	else {
 		ImGui::Text("%s", v.str.c_str());
@@ -117,7 +118,8 @@ void display_property(StringRef32& v) {
 
 void display_property(StringRef64& v) {
 	if (v.str.empty()) {
-		ImGui::Text("%s", v.getString(dispCtx.header).c_str());
+		auto str = v.getString(dispCtx.header);
+		ImGui::Text("%.*s", (int)str.size(), str.data());
 	}
 	else {
 		ImGui::Text("%s", v.str.c_str());
@@ -125,7 +127,7 @@ void display_property(StringRef64& v) {
 }
 
 void display_property(UnknownProperty& v) {
-	ImGui::Text("Unknown Property (Length %d)", v.data);
+	ImGui::Text("Unknown Property (Length %d)", (int)v.data.size());
 }
 
 void display_property(BoolProperty& v) {
@@ -180,8 +182,10 @@ void display_property(ObjectProperty& v) {
 	if (dispCtx.header != nullptr) {
 		auto &&link = dispCtx.header->getLinkRef(v.linkVal);
 
-		ImGui::Text("Value: %s", dispCtx.header->getHeaderRef(link.property).c_str());
-		ImGui::Text("Path: %s", dispCtx.header->getHeaderRef(dispCtx.header->getLinkRef(link.link).property).c_str());
+		auto value = dispCtx.header->getHeaderRef(link.property);
+		auto path = dispCtx.header->getHeaderRef(dispCtx.header->getLinkRef(link.link).property);
+		ImGui::Text("Value: %.*s", (int)value.size(), value.data());
+		ImGui::Text("Path: %.*s", (int)path.size(), path.data());
 	}
 	else {
 		ImGui::Text("Type: "); ImGui::SameLine(); display_property(v.type);
@@ -244,7 +248,7 @@ void display_property(StructProperty& v) {
 }
 
 void display_property(PropertyData &v) {
-	std::string name = v.nameRef.getString(dispCtx.header);
+	std::string name(v.nameRef.getString(dispCtx.header));
 	if (ImGui::CollapsingHeader(name.c_str())) {
 		ImGui::Text("Type:"); ImGui::SameLine(); display_property(v.typeRef);
 		ImGui::Text("Length: %d", v.length);
@@ -293,7 +297,7 @@ void display_category(DataTableCategory &cat) {
 
 	for (auto &&e : cat.entries) {
 		ImSubregion __(&e);
-		std::string rowName = e.rowName.getString(dispCtx.header);
+		std::string rowName(e.rowName.getString(dispCtx.header));
 		if (ImGui::CollapsingHeader(rowName.c_str())) {
 			display_property(e.value);
 		}
@@ -318,10 +322,12 @@ void display_asset(AssetData &assetData, AssetHeader *header) {
 	dispCtx.header = header;
 
 	if (ImGui::CollapsingHeader("Names")) {
-		size_t i = 0;
-		for (auto &&n : header->names) {
-			ImGui::InputText(("Name[" + std::to_string(i) + "]").c_str(), &n.name);
-			++i;
+		std::string name;
+		for (size_t i = 0; i < header->names.size(); ++i) {
+			name = header->names[i];
+			if (ImGui::InputText(("Name[" + std::to_string(i) + "]").c_str(), &name)) {
+				header->renameName(i, name);
+			}
 		}
 	}
 
@@ -329,13 +335,13 @@ void display_asset(AssetData &assetData, AssetHeader *header) {
 		for (auto &&c : assetData.catagoryValues) {
 			ImSubregion _(&c);
 
-			if (auto normCat = std::get_if<UObject>(&c.value)) {
+			if (auto normCat = std::get_if<UObject>(&c.value())) {
 				display_category(*normCat);
 			}
-			else if (auto dataCat = std::get_if<DataTableCategory>(&c.value)) {
+			else if (auto dataCat = std::get_if<DataTableCategory>(&c.value())) {
 				display_category(*dataCat);
 			}
-			else if (auto fusionAsset = std::get_if<HmxAssetFile>(&c.value)) {
+			else if (auto fusionAsset = std::get_if<HmxAssetFile>(&c.value())) {
 				display_category(*fusionAsset);
 			}
 		}
@@ -417,7 +423,7 @@ void display_fuser_assets() {
 			for (auto &&c : mainFile.celData) {
 				if (c.data.type.value == CelType::Type::Beat) {
 					auto &&fusionFile = c.data.majorAssets[0].data.fusionFile.data;
-					auto &&asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
+					auto &&asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
 
 					for (auto &&a : asset.audio.audioFiles) {
 						if (a.fileType == "FusionPatchResource") {
@@ -440,7 +446,7 @@ void display_fuser_assets() {
 			for (auto &&c : mainFile.celData) {
 				if (c.data.type.value == CelType::Type::Beat) {
 					auto &&fusionFile = c.data.majorAssets[0].data.fusionFile.data;
-					auto &&asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value);
+					auto &&asset = std::get<HmxAssetFile>(fusionFile.file.e->getData().data.catagoryValues[0].value());
 
 					for (auto &&a : asset.audio.audioFiles) {
 						if (a.fileType == "MoggSampleResource") {
@@ -461,7 +467,7 @@ void display_fuser_assets() {
 			for (auto &&c : mainFile.celData) {
 				if (c.data.type.value == CelType::Type::Beat) {
 					auto &&midiFile = c.data.majorAssets[0].data.midiFile.data;
-					auto &&asset = std::get<HmxAssetFile>(midiFile.file.e->getData().data.catagoryValues[0].value);
+					auto &&asset = std::get<HmxAssetFile>(midiFile.file.e->getData().data.catagoryValues[0].value());
 					asset.audio.audioFiles[0].fileData = std::move(fileData);
 				}
 			}
@@ -600,15 +606,7 @@ void window_loop() {
 				PakSigFile sigFile;
 				sigFile.encrypted_total_hash.resize(512);
 
-				const u32 chunkSize = 64 * 1024;
-				for (size_t start = 0; start < outBuf.size; start += chunkSize) {
-					size_t end = start + chunkSize;
-					if (end > outBuf.size) {
-						end = outBuf.size;
-					}
-
-					sigFile.chunks.emplace_back(CRC::MemCrc32(outBuf.buffer + start, end - start));
-				}
+				sigFile.chunks = PakSigFile::chunkCrcs(outBuf.buffer, outBuf.size);
 
 				std::vector<u8> sigOutData;
 				DataBuffer sigOutBuf;
@@ -626,8 +624,7 @@ void window_loop() {
 
 #ifdef DO_SONG_CREATION
 		DataBuffer dataBuf;
-		dataBuf.buffer = (u8*)custom_song_pak_template;
-		dataBuf.size = sizeof(custom_song_pak_template);
+		dataBuf.setupMemory((u8*)custom_song_pak_template, sizeof(custom_song_pak_template));
 		dataBuf.serialize(songPakFile);
 
 		for (auto &&e : songPakFile.entries) {
@@ -704,7 +701,7 @@ void window_loop() {
 #endif
 
 #if 0
-		if (auto normCat = std::get_if<NormalCategory>(&a.data.catagoryValues[0].value)) {
+		if (auto normCat = std::get_if<NormalCategory>(&a.data.catagoryValues[0].value())) {
 			auto createProp = [&](const std::string &name, asset_helper::PropertyValue &&v, std::optional<u32> idx = std::nullopt) {
 				PropertyData prop;
 				prop.nameRef = a.header.findOrCreateName(name);
@@ -760,7 +757,7 @@ void window_loop() {
 #endif
 
 #if defined(DO_ASSET_FILE) && 0
-		if (auto cat = std::get_if<DataTableCategory>(&a.data.catagoryValues[0].value)) {
+		if (auto cat = std::get_if<DataTableCategory>(&a.data.catagoryValues[0].value())) {
 
 #if 0
 			DataBuffer entryCloneBuffer;
@@ -888,15 +885,7 @@ void window_loop() {
 			PakSigFile sigFile;
 			sigFile.encrypted_total_hash.resize(512);
 
-			const u32 chunkSize = 64 * 1024;
-			for (size_t start = 0; start < outBuf.size; start += chunkSize) {
-				size_t end = start + chunkSize;
-				if (end > outBuf.size) {
-					end = outBuf.size;
-				}
-
-				sigFile.chunks.emplace_back(CRC::MemCrc32(outBuf.buffer + start, end - start));
-			}
+			sigFile.chunks = PakSigFile::chunkCrcs(outBuf.buffer, outBuf.size);
 
 			std::vector<u8> sigOutData;
 			DataBuffer sigOutBuf;
@@ -12,7 +12,7 @@ struct PlayableAudio {
 
 struct FuserEnums {
 	template<typename Enum>
-	static inline typename Enum::Value ToValue(const std::string &str) {
+	static inline typename Enum::Value ToValue(std::string_view str) {
 		typename Enum::Value v = static_cast<typename Enum::Value>(0);
 		size_t idx = 0;
 		for (auto &&s : Enum::GetValues()) {
@@ -257,7 +257,27 @@ struct SongSerializationCtx {
 	PakFile::PakEntry *curEntry = nullptr;
 
 
+	//While loading, every export of the entry is parsed here. Exports are otherwise parsed on first
+	//use, this makes a corrupt one fail the load rather than whatever reaches it later.
 	PakFile::PakEntry *getFile(const std::string &fullPath) {
+		auto e = findFile(fullPath);
+		if (e && loading) {
+			for (auto &&c : e->getData().data.catagoryValues) {
+				c.value();
+			}
+		}
+		return e;
+	}
+
+	PakFile::PakEntry *findFile(const std::string &fullPath) {
+		for (auto &&path : { fullPath, fullPath + ".uexp" }) {
+			auto e = pak->findEntry(path);
+			if (e && std::holds_alternative<PakFile::PakEntry::PakAssetData>(e->data)) {
+				return e;
+			}
+		}
+
+		//Paths that are only part of an entry's name
 		for (auto &&e : pak->entries) {
 			if (auto data = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
 				if (e.name.find(fullPath) != std::string::npos) {
@@ -269,6 +289,34 @@ struct SongSerializationCtx {
 		return nullptr;
 	}
 
+	//The song only writes to its entries through these, so an entry goes dirty when something in
+	//it actually changes, not whenever the save goes past it
+	template<typename T, typename V>
+	void assign(PakFile::PakEntry *entry, T &field, const V &value) {
+		if (!(field == value)) {
+			field = value;
+			entry->markDirty();
+		}
+	}
+
+	void renameName(PakFile::PakEntry *entry, size_t idx, std::string_view str) {
+		auto &&header = getHeader(entry);
+		if (header.names[idx] != str) {
+			header.renameName(idx, str);
+			entry->markDirty();
+		}
+	}
+
+	StringRef32 findOrCreateName(PakFile::PakEntry *entry, std::string_view str) {
+		auto &&header = getHeader(entry);
+		size_t count = header.names.size();
+		auto r = header.findOrCreateName(str);
+		if (header.names.size() != count) {
+			entry->markDirty();
+		}
+		return r;
+	}
+
 	AssetHeader &getHeader(PakFile::PakEntry *entry = nullptr) {
 		if (entry == nullptr) entry = curEntry;
 
@@ -280,7 +328,7 @@ struct SongSerializationCtx {
 	T* getProp(PakFile::PakEntry *entry, const std::string &propName) {
 		auto &&assetData = std::get<PakFile::PakEntry::PakAssetData>(entry->data);
 		AssetHeader *header = &std::get<AssetHeader>(assetData.pakHeader->data);
-		auto &&obj = std::get<UObject>(assetData.data.catagoryValues[0].value);
+		auto &&obj = std::get<UObject>(assetData.data.catagoryValues[0].value());
 
 		auto v = obj.data.get(header, propName);
 		if (!v) {
@@ -300,24 +348,25 @@ struct SongSerializationCtx {
 	NewProp<T> getOrCreateProp(PakFile::PakEntry *entry, const std::string &propName) {
 		auto &&assetData = std::get<PakFile::PakEntry::PakAssetData>(entry->data);
 		AssetHeader *header = &std::get<AssetHeader>(assetData.pakHeader->data);
-		auto &&obj = std::get<UObject>(assetData.data.catagoryValues[0].value);
+		auto &&obj = std::get<UObject>(assetData.data.catagoryValues[0].value());
 
 		auto v = obj.data.get(header, propName);
 		if (!v) {
 			T v;
 
 			PropertyData prop;
-			prop.nameRef = header->findOrCreateName(propName);
+			prop.nameRef = findOrCreateName(entry, propName);
 			prop.widgetData = 0;
-			prop.typeRef = header->findOrCreateName(asset_helper::getTypeForValue(v));
+			prop.typeRef = findOrCreateName(entry, asset_helper::getTypeForValue(v));
 			prop.value = std::move(v);
 			prop.length = sizeof(T);
 
-			obj.data.properties.emplace_back(std::move(prop));
+			auto &&added = obj.data.add(std::move(prop));
+			entry->markDirty();
 
 			NewProp<T> p;
-			p.propData = &obj.data.properties.back();
-			p.prop = &std::get<T>(obj.data.properties.back().value);
+			p.propData = &added;
+			p.prop = &std::get<T>(added.value);
 			return p;
 		}
 
@@ -343,7 +392,7 @@ struct SongSerializationCtx {
 			serializedStr = prop.name.getString(getHeader());
 		}
 		else {
-			getHeader().names[prop.name.ref].name = serializedStr;
+			renameName(curEntry, prop.name.ref, serializedStr);
 		}
 	}
 
@@ -353,7 +402,7 @@ struct SongSerializationCtx {
 			serializedStr = prop.value.getString(getHeader());
 		}
 		else {
-			prop.value = getHeader().findOrCreateName(serializedStr);
+			assign(curEntry, prop.value, findOrCreateName(curEntry, serializedStr));
 		}
 	}
 
@@ -363,7 +412,7 @@ struct SongSerializationCtx {
 			serializedStr = prop.str;
 		}
 		else {
-			prop.str = serializedStr;
+			assign(curEntry, prop.str, serializedStr);
 		}
 	}
 
@@ -373,7 +422,7 @@ struct SongSerializationCtx {
 			serializedStr = prop.strings.back();
 		}
 		else {
-			prop.strings.back() = serializedStr;
+			assign(curEntry, prop.strings.back(), serializedStr);
 		}
 	}
 
@@ -384,7 +433,7 @@ struct SongSerializationCtx {
 			value = prop.data;
 		}
 		else {
-			prop.data = value;
+			assign(curEntry, prop.data, value);
 		}
 	}
 
@@ -412,13 +461,14 @@ struct SongPakEntry {
 			path = parentPath + fileName;
 			name = fileName;
 
-			e->name = path + ".uexp";
-			std::get<PakFile::PakEntry::PakAssetData>(e->data).pakHeader->name = path + ".uasset";
+			//Entry names are in the index, which is written on every save
+			ctx.pak->renameEntry(*e, path + ".uexp");
+			ctx.pak->renameEntry(*e->getData().pakHeader, path + ".uasset");
 
-			header.names[header.catagories[0].objectName].name = fileName;
+			ctx.renameName(e, header.catagories[0].objectName, fileName);
 
 			if (thisObjectPath != -1) {
-				header.names[thisObjectPath].name = Game_Prefix + parentPath + fileName;
+				ctx.renameName(e, thisObjectPath, Game_Prefix + parentPath + fileName);
 			}
 		}
 	}
@@ -436,7 +486,7 @@ struct FileLink {
 		if (ctx.loading) {
 
 			auto &&linkedFile = header.getLinkRef(header.getLinkRef(linkVal).link);
-			data.file.e = ctx.getFile(header.getHeaderRef(linkedFile.property).substr(Game_Prefix.size()) + ".uexp");
+			data.file.e = ctx.getFile(std::string(header.getHeaderRef(linkedFile.property).substr(Game_Prefix.size())) + ".uexp");
 		}
 
 		if (data.file.e == nullptr) return;
@@ -445,10 +495,10 @@ struct FileLink {
 		ctx.curEntry = prevFile;
 
 		if (!ctx.loading) {
-			ctx.getHeader().names[ctx.getHeader().getLinkRef(linkVal).property].name = fs::path(data.file.path).stem().string();
+			ctx.renameName(ctx.curEntry, header.getLinkRef(linkVal).property, fs::path(data.file.path).stem().string());
 
 			auto &&linkedFile = header.getLinkRef(header.getLinkRef(linkVal).link);
-			ctx.getHeader().names[linkedFile.property].name = Game_Prefix + data.file.path;
+			ctx.renameName(ctx.curEntry, linkedFile.property, Game_Prefix + data.file.path);
 		}
 	}
 };
@@ -467,25 +517,23 @@ struct AssetLink {
 		auto &&header = ctx.getHeader();
 
 		if (ctx.loading) {
-			std::string fullPath = ref.getString(header);
+			std::string fullPath(ref.getString(header));
 			auto pos = fullPath.rfind('.');
 			std::string assetPath = fullPath.substr(0, pos);
 			hasExt = pos != std::string::npos;
 			if (hasExt) {
-				size_t idx = 0;
-				for (auto &&s : header.names) {
-					if (s.name == assetPath) {
+				for (size_t idx = 0; idx < header.names.size(); ++idx) {
+					if (header.names[idx] == assetPath) {
 						refWithoutExtension = StringRef32();
 						refWithoutExtension->ref = idx;
 					}
-					++idx;
 				}
 			}
 			//std::string assetName = fullPath.substr(pos + 1);
 			data.file.e = ctx.getFile(assetPath.substr(Game_Prefix.size()) + ".uexp");
 
 			for (auto &&l : header.links) {
-				if (l.link != 0 && header.names[header.getLinkRef(l.link).property].name == assetPath) {
+				if (l.link != 0 && header.names[header.getLinkRef(l.link).property] == assetPath) {
 					shortRef = StringRef32();
 					shortRef->ref = l.property;
 				}
@@ -505,17 +553,18 @@ struct AssetLink {
 
 			//@TODO: Another special case for beats
 			if (refWithoutExtension) {
-				header.names[refWithoutExtension->ref].name = assetPath;
+				ctx.renameName(ctx.curEntry, refWithoutExtension->ref, assetPath);
 			}
 
 			if (hasExt) {
-				assetPath += "." + subHeader.getHeaderRef(subHeader.catagories[0].objectName);
+				assetPath += ".";
+				assetPath += subHeader.getHeaderRef(subHeader.catagories[0].objectName);
 			}
-			header.names[ref.ref].name = assetPath;
+			ctx.renameName(ctx.curEntry, ref.ref, assetPath);
 
 			if (shortRef.has_value()) {
 				std::string shortName = assetPath.substr(assetPath.find_last_of('/') + 1);
-				header.names[shortRef->ref].name = shortName;
+				ctx.renameName(ctx.curEntry, shortRef->ref, shortName);
 			}
 		}
 	}
@@ -530,7 +579,7 @@ struct IconFileAsset {
 	void serialize(SongSerializationCtx& ctx) {
 		if (!ctx.loading) {
 			file.serialize(ctx, ctx.artRoot(), "T_"+ctx.shortName+ctx.isSmallArt());
-			auto&& texture = std::get<Texture2D>(file.e->getData().data.catagoryValues[0].value);
+			auto&& texture = std::get<Texture2D>(file.e->getData().data.catagoryValues[0].value());
 		}
 	}
 };
@@ -539,13 +588,13 @@ struct MidiFileAsset {
 	SongPakEntry file;
 	bool minor = false;
 	void serialize(SongSerializationCtx &ctx) {
-		auto&& hmxAsset = std::get<HmxAssetFile>(file.e->getData().data.catagoryValues[0].value);
+		auto&& hmxAsset = std::get<HmxAssetFile>(file.e->getData().data.catagoryValues[0].value());
 		auto& mfr = std::get<HmxAudio::PackageFile::MidiFileResource>(hmxAsset.audio.audioFiles[0].resourceHeader);
 		mfr.minor = minor;
 		if (!ctx.loading) {
 			file.serialize(ctx, ctx.folderRoot() + ctx.subCelFolder() + "midi/", ctx.subCelName() + "_mid" + ctx.midiSuffix());
-			hmxAsset.originalFilename = file.name;
-			hmxAsset.audio.audioFiles[0].fileName = Game_Prefix + file.path + ".mid";
+			ctx.assign(file.e, hmxAsset.originalFilename, file.name);
+			ctx.assign(file.e, hmxAsset.audio.audioFiles[0].fileName, Game_Prefix + file.path + ".mid");
 		}
 		
 	}
@@ -561,8 +610,8 @@ struct FusionFileAsset {
 		if (!ctx.loading) {
 			file.serialize(ctx, ctx.folderRoot() + ctx.subCelFolder() + "patches/", ctx.subCelName() + "_fusion");
 
-			auto &&asset = std::get<HmxAssetFile>(file.e->getData().data.catagoryValues[0].value);
-			asset.originalFilename = ctx.subCelName() + "_fusion";
+			auto &&asset = std::get<HmxAssetFile>(file.e->getData().data.catagoryValues[0].value());
+			ctx.assign(file.e, asset.originalFilename, ctx.subCelName() + "_fusion");
 
 			std::vector<HmxAudio::PackageFile*> moggFiles;
 			HmxAudio::PackageFile *fusionFile;
@@ -593,13 +642,14 @@ struct FusionFileAsset {
 					alnodes->children.emplace_back(audiolabel);
 				}
 				fusion.nodes.children.insert(fusion.nodes.children.begin(), audiolabelholder);
+				file.e->markDirty();
 			}
 			auto& audioLabels = fusion.nodes.getNode("audio_labels");
 			int testidx = 0;
 			for (auto& label : audioLabels.children) {
 				
 				size_t found1 = label.key.rfind("_");
-				label.key = ctx.subCelName() + label.key.substr(found1, label.key.length());
+				ctx.assign(file.e, label.key, ctx.subCelName() + label.key.substr(found1, label.key.length()));
 				testidx++;
 			}
 			for (auto &&f : moggFiles) {
@@ -607,10 +657,10 @@ struct FusionFileAsset {
 				size_t found2 = f->fileName.rfind(".mogg");
 				std::string key = f->fileName.substr(found1, found2 - found1);
 
-				f->fileName = "C:/" + ctx.subCelName() + key + ".mogg";
+				ctx.assign(file.e, f->fileName, "C:/" + ctx.subCelName() + key + ".mogg");
 				auto &&moggHeader = std::get<HmxAudio::PackageFile::MoggSampleResourceHeader>(f->resourceHeader);			
 			}
-			fusionFile->fileName = Game_Prefix + file.path + ".fusion";
+			ctx.assign(file.e, fusionFile->fileName, Game_Prefix + file.path + ".fusion");
 			for (auto c : map.children) {
 				auto nodes = std::get<hmx_fusion_nodes*>(c.value);
 
@@ -618,7 +668,7 @@ struct FusionFileAsset {
 				size_t found1 = nodes->getString("sample_path").rfind("_");
 				size_t found2 = nodes->getString("sample_path").rfind(".mogg");
 				std::string key = nodes->getString("sample_path").substr(found1, found2 - found1);
-				nodes->getString("sample_path") = "C:/" + ctx.subCelName() + key + ".mogg";
+				ctx.assign(file.e, nodes->getString("sample_path"), "C:/" + ctx.subCelName() + key + ".mogg");
 
 				auto&& ts = nodes->getNode("timestretch_settings");
 				if (ts.getChild("orig_tempo_sync") == nullptr) {
@@ -626,11 +676,12 @@ struct FusionFileAsset {
 					label.key = "orig_tempo_sync";
 					label.value = 1;
 					ts.children.insert(ts.children.begin(), label);
-					ts.getInt("orig_tempo") = ctx.bpm;
+					file.e->markDirty();
+					ctx.assign(file.e, ts.getInt("orig_tempo"), ctx.bpm);
 				}
 				else {
 					if (ts.getInt("orig_tempo_sync") == 1) {
-						ts.getInt("orig_tempo") = ctx.bpm;
+						ctx.assign(file.e, ts.getInt("orig_tempo"), ctx.bpm);
 					}
 				}
 				
@@ -647,7 +698,7 @@ struct MidiSongAsset {
 	AssetLink<FusionFileAsset> fusionFile;
 
 	void serialize(SongSerializationCtx &ctx) {
-		auto &&hmxAsset = std::get<HmxAssetFile>(file.e->getData().data.catagoryValues[0].value);
+		auto &&hmxAsset = std::get<HmxAssetFile>(file.e->getData().data.catagoryValues[0].value());
 		auto &&midiMusic = std::get<HmxAudio::PackageFile::MidiMusicResource>(hmxAsset.audio.audioFiles[0].resourceHeader);
 		if (ctx.loading) {
 			auto fusionPath = midiMusic.patch_engine_path.str;
@@ -678,15 +729,15 @@ struct MidiSongAsset {
 			std::string fileName = ctx.subCelName() + "_midisong" + (ctx.curMidiType == MidiType::Major ? "_maj" : "_min");
 			file.serialize(ctx, ctx.folderRoot() + ctx.subCelFolder(), fileName);
 
-			hmxAsset.originalFilename = fileName;
-			hmxAsset.audio.audioFiles[0].fileName = Game_Prefix + file.path + ".midisong";
+			ctx.assign(file.e, hmxAsset.originalFilename, fileName);
+			ctx.assign(file.e, hmxAsset.audio.audioFiles[0].fileName, Game_Prefix + file.path + ".midisong");
 
-			midiMusic.mid_engine_path.str = Game_Prefix + midiFile.data.file.path + ".mid";
-			midiMusic.patch_engine_path.str = Game_Prefix + fusionFile.data.file.path + ".fusion";
-			midiMusic.midisong_engine_path.str = Game_Prefix + file.path + ".midisong";
-			midiMusic.midisong_name.str = fileName + ".midisong";
-			midiMusic.root.children[0].getArray().children[1].getString().str = "midi/" + midiFile.data.file.name + ".mid";
-			midiMusic.root.children[1].getArray().children[1].getArray().children[2].getArray().children[1].getString().str = "patches/" + fusionFile.data.file.name + ".fusion";
+			ctx.assign(file.e, midiMusic.mid_engine_path.str, Game_Prefix + midiFile.data.file.path + ".mid");
+			ctx.assign(file.e, midiMusic.patch_engine_path.str, Game_Prefix + fusionFile.data.file.path + ".fusion");
+			ctx.assign(file.e, midiMusic.midisong_engine_path.str, Game_Prefix + file.path + ".midisong");
+			ctx.assign(file.e, midiMusic.midisong_name.str, fileName + ".midisong");
+			ctx.assign(file.e, midiMusic.root.children[0].getArray().children[1].getString().str, "midi/" + midiFile.data.file.name + ".mid");
+			ctx.assign(file.e, midiMusic.root.children[1].getArray().children[1].getArray().children[2].getArray().children[1].getString().str, "patches/" + fusionFile.data.file.name + ".fusion");
 		}
 	}
 };
@@ -744,29 +795,32 @@ struct SongTransition {
 				{ std::string _enumKeyNum("EKey::Num"); ctx.serializeEnum("Key", _enumKeyNum); }
 			}
 			auto prop = ctx.getOrCreateProp<EnumProperty>("Mode");
-			prop.propData->typeRef = ctx.getHeader().findOrCreateName("EnumProperty");
-			prop.propData->length = 8;
-			prop.prop->enumType = ctx.getHeader().findOrCreateName("EKeyMode");
-			prop.prop->blank = 0;
+			ctx.assign(ctx.curEntry, prop.propData->typeRef, ctx.findOrCreateName(ctx.curEntry, "EnumProperty"));
+			ctx.assign(ctx.curEntry, prop.propData->length, 8);
+			ctx.assign(ctx.curEntry, prop.prop->enumType, ctx.findOrCreateName(ctx.curEntry, "EKeyMode"));
+			ctx.assign(ctx.curEntry, prop.prop->blank, 0);
 			if (!allUnpitched) {
-				prop.prop->value = ctx.getHeader().findOrCreateName(FuserEnums::FromValue<FuserEnums::KeyMode>(ctx.curKeyMode));
+				ctx.assign(ctx.curEntry, prop.prop->value, ctx.findOrCreateName(ctx.curEntry, FuserEnums::FromValue<FuserEnums::KeyMode>(ctx.curKeyMode)));
 			}
 			else {
-				prop.prop->value = ctx.getHeader().findOrCreateName(FuserEnums::FromValue<FuserEnums::KeyMode>(FuserEnums::KeyMode::Value::Num));
+				ctx.assign(ctx.curEntry, prop.prop->value, ctx.findOrCreateName(ctx.curEntry, FuserEnums::FromValue<FuserEnums::KeyMode>(FuserEnums::KeyMode::Value::Num)));
 			}
 			
 			//Construct Transpose Table
 			if (!allUnpitched){
 				struct Transpose {
 					PropertyData* data;
+					IPropertyDataList* list;
 				};
 				std::vector<Transpose> tpose;
 
 				auto&& transposes = *ctx.getProp<StructProperty>("Transposes");
 				for (auto&& v : transposes.values) {
-					for (auto&& p : std::get<IPropertyDataList*>(v->v)->properties) {
+					auto list = std::get<IPropertyDataList*>(v->v);
+					for (auto&& p : list->properties) {
 						Transpose t;
 						t.data = &p;
+						t.list = list;
 						tpose.emplace_back(std::move(t));
 					}
 				}
@@ -784,7 +838,7 @@ struct SongTransition {
 
 				//Check to see if we find ourself in the list (this means our key has changed)
 				for (auto&& p : tpose) {
-					std::string key = "EKey::" + p.data->nameRef.getString(ctx.getHeader());
+					std::string key = "EKey::" + std::string(p.data->nameRef.getString(ctx.getHeader()));
 					if (key == ctx.songKey) {
 
 						size_t missingValue = 0;
@@ -792,7 +846,7 @@ struct SongTransition {
 
 							bool found = false;
 							for (auto&& p : tpose) {
-								std::string refKey = "EKey::" + p.data->nameRef.getString(ctx.getHeader());
+								std::string refKey = "EKey::" + std::string(p.data->nameRef.getString(ctx.getHeader()));
 								if (keyValues[i] == refKey) {
 									found = true;
 									break;
@@ -805,7 +859,8 @@ struct SongTransition {
 							}
 						}
 
-						p.data->nameRef = ctx.getHeader().findOrCreateName(keyValues[missingValue].substr(sizeof("EKey::") - 1));
+						ctx.assign(ctx.curEntry, p.data->nameRef, ctx.findOrCreateName(ctx.curEntry, keyValues[missingValue].substr(sizeof("EKey::") - 1)));
+						p.list->invalidateIndex();
 						break;
 					}
 				}
@@ -813,7 +868,7 @@ struct SongTransition {
 				//Now we can compute the offsets
 				i32 songKeyIdx = find_idx(ctx.songKey);
 				for (auto&& p : tpose) {
-					std::string key = "EKey::" + p.data->nameRef.getString(ctx.getHeader());
+					std::string key = "EKey::" + std::string(p.data->nameRef.getString(ctx.getHeader()));
 					i32 idx = find_idx(key);
 					i32 offset = idx - songKeyIdx;
 					if (offset <= -6) {
@@ -822,7 +877,7 @@ struct SongTransition {
 					else if (offset >= 6) {
 						offset -= 12;
 					}
-					std::get<PrimitiveProperty<i32>>(p.data->value).data = offset;
+					ctx.assign(ctx.curEntry, std::get<PrimitiveProperty<i32>>(p.data->value).data, offset);
 				}
 
 			}
@@ -856,11 +911,43 @@ struct CelData {
 	std::vector<AssetLink<MidiSongAsset>> majorAssets;
 	std::vector<AssetLink<MidiSongAsset>> minorAssets;
 	ArrayProperty* pickupArray;
+	Arena* pickupArena;
+	//Pickup nodes taken out of pickupArray. The arena only frees nodes along with the asset, so
+	//these get reused instead of making new ones on every edit.
+	std::vector<IPropertyValue*> sparePickups;
 	float trackGain = 0;
 	int tickLength = 61440;
 
 	bool allUnpitched = false;
 
+	//Replaces the pickup beats, reusing the array's nodes and the spare ones before making more
+	void setPickups(const std::vector<float> &pickups) {
+		auto &&values = pickupArray->values;
+		while (values.size() > pickups.size()) {
+			sparePickups.emplace_back(values.back());
+			values.pop_back();
+		}
+		while (values.size() < pickups.size()) {
+			if (sparePickups.empty()) {
+				values.emplace_back(pickupArena->make<IPropertyValue>());
+			}
+			else {
+				values.emplace_back(sparePickups.back());
+				sparePickups.pop_back();
+			}
+		}
+
+		for (size_t i = 0; i < pickups.size(); ++i) {
+			values[i]->v = asset_helper::createPropertyValue("FloatProperty");
+			std::get<PrimitiveProperty<float>>(values[i]->v).data = pickups[i];
+		}
+	}
+
+	void removePickup(size_t idx) {
+		sparePickups.emplace_back(pickupArray->values[idx]);
+		pickupArray->values.erase(pickupArray->values.begin() + idx);
+	}
+
 	//std::vector<float> pickupsTest;
 	void serialize(SongSerializationCtx &ctx) {
 		if (ctx.loading) {
@@ -947,6 +1034,7 @@ struct CelData {
 			}
 
 			pickupArray = ctx.getProp<ArrayProperty>("PickupBeats");
+			pickupArena = ctx.curEntry->getData().arena.get();
 			
 		}
 
@@ -970,31 +1058,34 @@ struct CelData {
 			}
 			
 			auto prop = ctx.getOrCreateProp<EnumProperty>("Mode");
-			prop.propData->typeRef = ctx.getHeader().findOrCreateName("EnumProperty");
-			prop.propData->length = 8;
-			prop.prop->enumType = ctx.getHeader().findOrCreateName("EKeyMode");
-			prop.prop->blank = 0;
+			ctx.assign(ctx.curEntry, prop.propData->typeRef, ctx.findOrCreateName(ctx.curEntry, "EnumProperty"));
+			ctx.assign(ctx.curEntry, prop.propData->length, 8);
+			ctx.assign(ctx.curEntry, prop.prop->enumType, ctx.findOrCreateName(ctx.curEntry, "EKeyMode"));
+			ctx.assign(ctx.curEntry, prop.prop->blank, 0);
 			if (!allUnpitched) {
-				prop.prop->value = ctx.getHeader().findOrCreateName(FuserEnums::FromValue<FuserEnums::KeyMode>(ctx.curKeyMode));
+				ctx.assign(ctx.curEntry, prop.prop->value, ctx.findOrCreateName(ctx.curEntry, FuserEnums::FromValue<FuserEnums::KeyMode>(ctx.curKeyMode)));
 			}
 			else {
-				prop.prop->value = ctx.getHeader().findOrCreateName(FuserEnums::FromValue<FuserEnums::KeyMode>(FuserEnums::KeyMode::Value::Num));
+				ctx.assign(ctx.curEntry, prop.prop->value, ctx.findOrCreateName(ctx.curEntry, FuserEnums::FromValue<FuserEnums::KeyMode>(FuserEnums::KeyMode::Value::Num)));
 			}
 			
 			auto tlprop = ctx.getOrCreateProp<PrimitiveProperty<int>>("SongLengthTicks");
-			tlprop.prop->data = tickLength;
+			ctx.assign(ctx.curEntry, tlprop.prop->data, tickLength);
 
 			if (!allUnpitched) {
 				struct Transpose {
 					PropertyData *data;
+					IPropertyDataList *list;
 				};
 				std::vector<Transpose> tpose;
 
 				auto&& transposes = *ctx.getProp<StructProperty>("Transposes");
 				for (auto &&v : transposes.values) {
-					for (auto &&p : std::get<IPropertyDataList*>(v->v)->properties) {
+					auto list = std::get<IPropertyDataList*>(v->v);
+					for (auto &&p : list->properties) {
 						Transpose t;
 						t.data = &p;
+						t.list = list;
 						tpose.emplace_back(std::move(t));
 					}
 				}
@@ -1012,7 +1103,7 @@ struct CelData {
 
 				//Check to see if we find ourself in the list (this means our key has changed)
 				for (auto &&p : tpose) {
-					std::string key = "EKey::" + p.data->nameRef.getString(ctx.getHeader());
+					std::string key = "EKey::" + std::string(p.data->nameRef.getString(ctx.getHeader()));
 					if (key == ctx.songKey) {
 
 						size_t missingValue = 0;
@@ -1020,7 +1111,7 @@ struct CelData {
 
 							bool found = false;
 							for (auto &&p : tpose) {
-								std::string refKey = "EKey::" + p.data->nameRef.getString(ctx.getHeader());
+								std::string refKey = "EKey::" + std::string(p.data->nameRef.getString(ctx.getHeader()));
 								if (keyValues[i] == refKey) {
 									found = true;
 									break;
@@ -1033,7 +1124,8 @@ struct CelData {
 							}
 						}
 
-						p.data->nameRef = ctx.getHeader().findOrCreateName(keyValues[missingValue].substr(sizeof("EKey::") - 1));
+						ctx.assign(ctx.curEntry, p.data->nameRef, ctx.findOrCreateName(ctx.curEntry, keyValues[missingValue].substr(sizeof("EKey::") - 1)));
+						p.list->invalidateIndex();
 						break;
 					}
 				}
@@ -1041,7 +1133,7 @@ struct CelData {
 				//Now we can compute the offsets
 				i32 songKeyIdx = find_idx(ctx.songKey);
 				for (auto &&p : tpose) {
-					std::string key = "EKey::" + p.data->nameRef.getString(ctx.getHeader());
+					std::string key = "EKey::" + std::string(p.data->nameRef.getString(ctx.getHeader()));
 					i32 idx = find_idx(key);
 					i32 offset = idx - songKeyIdx;
 					if (offset <= -6) {
@@ -1050,7 +1142,7 @@ struct CelData {
 					else if (offset >= 6) {
 						offset -= 12;
 					}
-					std::get<PrimitiveProperty<i32>>(p.data->value).data = offset;
+					ctx.assign(ctx.curEntry, std::get<PrimitiveProperty<i32>>(p.data->value).data, offset);
 				}
 
 			}
@@ -1157,7 +1249,7 @@ struct AssetRoot {
 			ctx.serializeName("SongShortName", shortName);
 			ctx.serializeEnum("Genre", genreStr);
 			auto streamOptimizedProp = ctx.getOrCreateProp<BoolProperty>("IsStreamOptimized");
-			streamOptimizedProp.prop->value = isStreamOptimized;
+			ctx.assign(ctx.curEntry, streamOptimizedProp.prop->value, isStreamOptimized);
 
 			size_t idx = 0;
 			for (auto &&e : celData) {
@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path) {
+	auto file = std::make_shared<MappedFile>();
+	file->filePath = path;
+
+#ifdef _WIN32
+	//Sharing delete lets releasePath() move the file while it's mapped
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	file->fileHandle = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize)) {
+		return nullptr;
+	}
+	file->length = (size_t)fileSize.QuadPart;
+
+	//Mapping an empty file fails, there's nothing to map anyway
+	if (file->length == 0) {
+		return file;
+	}
+
+	HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		return nullptr;
+	}
+	file->mappingHandle = mapping;
+
+	file->ptr = (const u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (file->ptr == nullptr) {
+		return nullptr;
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return nullptr;
+	}
+	file->length = (size_t)st.st_size;
+
+	if (file->length == 0) {
+		close(fd);
+		return file;
+	}
+
+	//The mapping keeps the file referenced, the descriptor isn't needed past this
+	void *mapped = mmap(nullptr, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		return nullptr;
+	}
+	file->ptr = (const u8*)mapped;
+#endif
+
+	return file;
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+bool MappedFile::releasePath() {
+#ifdef _WIN32
+	if (!releasedPath.empty()) {
+		return true;
+	}
+
+	//Unique among the files that are still mapped
+	std::string aside = filePath + "." + std::to_string((uintptr_t)this) + ".old";
+	if (!MoveFileExA(filePath.c_str(), aside.c_str(), 0)) {
+		return false;
+	}
+	releasedPath = aside;
+#endif
+	return true;
+}
+
+void MappedFile::restorePath() {
+#ifdef _WIN32
+	if (!releasedPath.empty() && MoveFileExA(releasedPath.c_str(), filePath.c_str(), 0)) {
+		releasedPath.clear();
+	}
+#endif
+}
+
+void MappedFile::unmap() {
+#ifdef _WIN32
+	if (ptr) {
+		UnmapViewOfFile(ptr);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle) {
+		CloseHandle(fileHandle);
+		fileHandle = nullptr;
+	}
+	if (!releasedPath.empty()) {
+		DeleteFileA(releasedPath.c_str());
+		releasedPath.clear();
+	}
+#else
+	if (ptr) {
+		munmap((void*)ptr, length);
+	}
+#endif
+	ptr = nullptr;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "core_types.h"
+
+#include <memory>
+
+//A file mapped read-only into memory. Paks are loaded straight out of the mapping, so only the
+//parts that actually get parsed are paged in.
+struct MappedFile {
+	//nullptr if the file can't be opened
+	static std::shared_ptr<MappedFile> open(const std::string &path);
+
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile &operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	const u8 *data() const { return ptr; }
+	size_t size() const { return length; }
+	const std::string &path() const { return filePath; }
+
+	//Gets the file out of the way of a new one taking its path (saving over the pak that's open),
+	//views into the mapping stay valid. Only Windows needs it: there the file is moved aside, and
+	//deleted once it's unmapped. Elsewhere replacing the path leaves the mapped file alone.
+	bool releasePath();
+	//Puts the file back if nothing took its path after releasePath() after all
+	void restorePath();
+
+private:
+	void unmap();
+
+	std::string filePath;
+	const u8 *ptr = nullptr;
+	size_t length = 0;
+
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+	//Where releasePath() moved the file to
+	std::string releasedPath;
+#endif
+};
+
+//Bulk payload bytes (stems, mips, properties we don't parse). Loading them out of a MappedFile
+//keeps them as a view into the mapping; they get memory of their own the first time they change.
+struct MappedBytes {
+	MappedBytes() = default;
+	MappedBytes(const std::vector<u8> &v) : bytes(v) {}
+	MappedBytes(std::vector<u8> &&v) : bytes(std::move(v)) {}
+
+	void setView(std::shared_ptr<MappedFile> file, size_t offset, size_t size) {
+		bytes.clear();
+		source = std::move(file);
+		viewOffset = offset;
+		viewSize = size;
+	}
+
+	bool isView() const { return source != nullptr; }
+	//The mapping this is a view into, nullptr if the bytes are owned
+	const std::shared_ptr<MappedFile> &file() const { return source; }
+
+	const u8 *data() const { return source ? source->data() + viewOffset : bytes.data(); }
+	size_t size() const { return source ? viewSize : bytes.size(); }
+	bool empty() const { return size() == 0; }
+
+	const u8 &operator[](size_t i) const { return data()[i]; }
+	const u8 *begin() const { return data(); }
+	const u8 *end() const { return data() + size(); }
+
+	//Storage that can be modified, copied out of the mapping if this is still a view
+	std::vector<u8> &owned() {
+		if (source) {
+			bytes.assign(begin(), end());
+			source.reset();
+			viewOffset = 0;
+			viewSize = 0;
+		}
+		return bytes;
+	}
+
+	void clear() {
+		source.reset();
+		viewOffset = 0;
+		viewSize = 0;
+		bytes.clear();
+	}
+
+	void resize(size_t size) { owned().resize(size); }
+	void push_back(u8 b) { owned().push_back(b); }
+
+private:
+	std::vector<u8> bytes;
+	std::shared_ptr<MappedFile> source;
+	size_t viewOffset = 0;
+	size_t viewSize = 0;
+};
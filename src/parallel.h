@@ -0,0 +1,184 @@
+#pragma once
+#include "core_types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace parallel {
+	//Threads worth using for CPU bound work, including the calling one. FUSER_WORKERS overrides it,
+	//so the benchmarks can measure how the work scales.
+	inline size_t workerCount() {
+		static const size_t count = []() -> size_t {
+			if (const char *env = getenv("FUSER_WORKERS")) {
+				return std::max<long>(1, atol(env));
+			}
+			return std::max<size_t>(1, std::thread::hardware_concurrency());
+		}();
+		return count;
+	}
+
+	//Worker threads started on first use and kept until exit, so spreading work out costs a wakeup
+	//instead of starting threads every time. One job runs at a time.
+	struct Pool {
+		static Pool &get() {
+			static Pool pool(workerCount() - 1);
+			return pool;
+		}
+
+		explicit Pool(size_t threads) {
+			workers.reserve(threads);
+			for (size_t t = 0; t < threads; ++t) {
+				workers.emplace_back([this]() { workerLoop(); });
+			}
+		}
+
+		Pool(const Pool&) = delete;
+		Pool &operator=(const Pool&) = delete;
+
+		~Pool() {
+			{
+				std::lock_guard<std::mutex> l(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+
+			for (auto &&t : workers) {
+				t.join();
+			}
+		}
+
+		size_t size() const {
+			return workers.size();
+		}
+
+		//Runs work() on every worker and the calling thread, and returns once they've all come back.
+		//work() shouldn't throw on the workers, forEach catches everything itself.
+		//Returns false without running anything if there are no workers, the pool is busy with another
+		//thread's job, or this thread is already running a job (one spreading out work of its own).
+		bool run(const std::function<void()> &work) {
+			if (workers.empty() || inJob()) {
+				return false;
+			}
+
+			std::unique_lock<std::mutex> busy(jobLock, std::try_to_lock);
+			if (!busy.owns_lock()) {
+				return false;
+			}
+
+			{
+				std::lock_guard<std::mutex> l(lock);
+				job = &work;
+				running = workers.size();
+				++generation;
+			}
+			wake.notify_all();
+
+			//The workers still hold a reference to work, so wait for them even if this thread's share throws
+			std::exception_ptr error;
+			inJob() = true;
+			try {
+				work();
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			inJob() = false;
+
+			{
+				std::unique_lock<std::mutex> l(lock);
+				finished.wait(l, [&]() { return running == 0; });
+				job = nullptr;
+			}
+
+			if (error) {
+				std::rethrow_exception(error);
+			}
+			return true;
+		}
+
+	private:
+		std::vector<std::thread> workers;
+		//Held for the whole of a job, so a second caller can tell the pool is busy
+		std::mutex jobLock;
+
+		std::mutex lock;
+		std::condition_variable wake;
+		std::condition_variable finished;
+		const std::function<void()> *job = nullptr;
+		size_t running = 0;
+		u64 generation = 0;
+		bool stopping = false;
+
+		//Set on the workers, and on the calling thread while it runs its share of a job
+		static bool &inJob() {
+			thread_local bool running = false;
+			return running;
+		}
+
+		void workerLoop() {
+			inJob() = true;
+
+			u64 seen = 0;
+			std::unique_lock<std::mutex> l(lock);
+			while (true) {
+				wake.wait(l, [&]() { return stopping || generation != seen; });
+				if (stopping) {
+					return;
+				}
+
+				seen = generation;
+				auto work = job;
+				l.unlock();
+				(*work)();
+				l.lock();
+
+				if (--running == 0) {
+					finished.notify_all();
+				}
+			}
+		}
+	};
+
+	//Calls fn(i) for every i in [0, count), spread over the pool's threads and the calling one. Each
+	//call should only write to its own slot, so the results don't depend on which thread ran what.
+	//If any calls throw, the exception from the lowest index is rethrown once they've all finished.
+	//Runs on the calling thread alone when the pool is already busy (e.g. forEach inside forEach).
+	template<typename Fn>
+	void forEach(size_t count, Fn &&fn) {
+		if (std::min(workerCount(), count) <= 1) {
+			for (size_t i = 0; i < count; ++i) {
+				fn(i);
+			}
+			return;
+		}
+
+		std::vector<std::exception_ptr> errors(count);
+		std::atomic<size_t> next{ 0 };
+		std::function<void()> work = [&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				try {
+					fn(i);
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
+			}
+		};
+
+		if (!Pool::get().run(work)) {
+			work();
+		}
+
+		for (auto &&e : errors) {
+			if (e) {
+				std::rethrow_exception(e);
+			}
+		}
+	}
+}
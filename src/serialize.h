@@ -1,94 +1,593 @@
 #pragma once
 #include "core_types.h"
+#include "sha1.h"
+#include "crc.h"
+#include "mapped_file.h"
+#include "utf_convert.h"
 
 #include <type_traits>
 #include <functional>
 #include <optional>
-#include <codecvt>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 template<class ...Ts>
 struct voider {
 	using type = void;
 };
 
+//The fields of a struct in the order they're serialized, for structs that are nothing but their
+//fields:
+//	using fields = FieldList<&Tempo::start_ms, &Tempo::start_tick, &Tempo::tempo>;
+//DataBuffer then serializes the struct without it needing a serialize() of its own. If the fields
+//fill the whole struct without padding (list them in declaration order), it's read and written as
+//one block, and so are arrays of it. That relies on paks and all our platforms being little endian.
+template<auto... Members>
+struct FieldList {
+	template<typename T, typename Fn>
+	static void forEach(T &data, Fn &&fn) {
+		(fn(data.*Members), ...);
+	}
+
+	template<typename T>
+	static constexpr size_t fieldsSize() {
+		return (sizeof(std::remove_reference_t<decltype(std::declval<T&>().*Members)>) + ... + 0);
+	}
+
+	//Each field starts right where the previous one ends
+	template<typename T>
+	static bool contiguous(const T &data) {
+		const u8 *next = (const u8*)&data;
+		bool ok = true;
+		((ok = ok && (const u8*)&(data.*Members) == next, next += sizeof(data.*Members)), ...);
+		return ok;
+	}
+};
+
+//Output file for DataBuffer::setupFile(). Writes collect in a window that goes to disk once it
+//gets big. Everything goes out once and in order, so what's on disk can't change anymore, apart
+//from the SHA-1 records added with hashInto().
+//
+//Full windows are handed to a writer thread while the next one fills up. It takes them a slice at
+//a time through the CRC chunker, out to disk and into the SHA-1 of every range being hashed, so
+//each of them reads the slice from cache. Big blocks (stems, textures) go through the same steps
+//from where they already are, on the calling thread.
+struct FileSink {
+	static constexpr size_t WINDOW_SIZE = 4 * 1024 * 1024;
+	//Emitted data is CRC'd, written and hashed this much at a time
+	static constexpr size_t EMIT_SLICE = 256 * 1024;
+
+	std::fstream file;
+	std::vector<u8> window;
+	size_t windowStart = 0;
+
+	//Optional CRC32 per fixed size chunk of the file (for .sig files), computed as the data goes
+	//to disk
+	size_t crcChunkSize = 0;
+	std::vector<u32> chunkCrcs;
+	u32 runningCrc = 0;
+	size_t runningLen = 0;
+
+	FileSink() = default;
+	FileSink(const FileSink&) = delete;
+	FileSink &operator=(const FileSink&) = delete;
+	~FileSink() {
+		stopWriter();
+	}
+
+	bool open(const std::string &path) {
+		stopWriter();
+
+		filePath = path;
+		file.open(path, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
+		window.clear();
+		window.reserve(WINDOW_SIZE);
+		windowStart = 0;
+		chunkCrcs.clear();
+		runningCrc = 0;
+		runningLen = 0;
+		runningFixes.clear();
+		queuedHashes.clear();
+		hashes.clear();
+		failed = false;
+		if (!file.is_open()) {
+			return false;
+		}
+
+		stopping = false;
+		writer = std::thread([this]() { writerLoop(); });
+		return true;
+	}
+
+	void trackChunkCrcs(size_t chunkSize) {
+		crcChunkSize = chunkSize;
+		zeros.assign(chunkSize, 0);
+	}
+
+	//Sizes the file up front when its final size is known, instead of it growing a write at a time
+	void reserve(size_t size) {
+		drain();
+		file.flush();
+		std::error_code ec;
+		std::filesystem::resize_file(filePath, size, ec);
+	}
+
+	//SHA-1 of [start, start + size) of the file, computed as it goes to disk. The digest is stored
+	//into digest and written over the 20 bytes at recordAt. The record has to come before the end
+	//of the range, and this has to be called before the record is written.
+	void hashInto(size_t start, size_t size, size_t recordAt, u8 *digest) {
+		RangeHash h;
+		h.start = start;
+		h.size = size;
+		h.recordAt = recordAt;
+		h.digest = digest;
+		h.sha.reset();
+
+		std::lock_guard<std::mutex> l(lock);
+		queuedHashes.emplace_back(h);
+	}
+
+	void write(size_t at, const u8 *data, size_t len) {
+		if (at < windowStart) {
+			throw std::logic_error("FileSink: writing over data that's already gone to disk");
+		}
+
+		//Big blocks right at the end go straight to disk instead of through the window
+		if (len >= WINDOW_SIZE && at == windowStart + window.size()) {
+			flushWindow();
+			drain();
+			emit(windowStart, data, len);
+			windowStart += len;
+			return;
+		}
+
+		//Growing the window zero fills anything we seeked past
+		size_t end = at - windowStart + len;
+		if (end > window.size()) {
+			window.resize(end);
+		}
+		memcpy(window.data() + (at - windowStart), data, len);
+
+		if (window.size() >= WINDOW_SIZE) {
+			flushWindow();
+		}
+	}
+
+	//Returns false if anything so far failed to make it to disk. Every range hashed so far has
+	//its digest once this returns.
+	bool flush() {
+		flushWindow();
+		drain();
+
+		//Ranges that end right where the file does, with nothing after them to finish them
+		takeQueuedHashes();
+		hashSlice(windowStart, nullptr, 0);
+
+		file.flush();
+		checkFile();
+		return !failed;
+	}
+
+	//False once a seek or write has failed (disk full, file gone). Whatever was written after
+	//that is lost, so the file is no good.
+	bool good() {
+		drain();
+		return !failed;
+	}
+
+	//Flushes everything and returns the CRC of every chunk of the finished file
+	const std::vector<u32>& finishChunkCrcs() {
+		flush();
+		if (runningLen > 0) {
+			closeChunk();
+		}
+
+		return chunkCrcs;
+	}
+
+private:
+	std::string filePath;
+	std::thread writer;
+	std::mutex lock;
+	std::condition_variable changed;
+	//The window the writer thread is working on, at pendingStart in the file
+	std::vector<u8> pending;
+	size_t pendingStart = 0;
+	bool hasPending = false;
+	bool stopping = false;
+	//Set on whichever thread has the file at the time, the writer's only ever read after drain()
+	bool failed = false;
+
+	struct RangeHash {
+		size_t start;
+		size_t size;
+		size_t recordAt;
+		u8 *digest;
+		SHA1 sha;
+		//What was written at recordAt before the digest was known
+		u8 placeholder[sizeof(SHA1::digest)] = {};
+	};
+	//Added since the writer last looked, under lock
+	std::vector<RangeHash> queuedHashes;
+	//Being hashed, by whichever thread is emitting
+	std::vector<RangeHash> hashes;
+
+	//A record rewritten in the chunk that's still being CRC'd, applied once its length is known
+	struct CrcFix {
+		size_t offset;
+		size_t len;
+		u8 delta[sizeof(SHA1::digest)];
+	};
+	std::vector<CrcFix> runningFixes;
+	std::vector<u8> zeros;
+
+	void checkFile() {
+		if (file.fail()) {
+			failed = true;
+		}
+	}
+
+	//Gives the window to the writer thread and starts a new one right after it
+	void flushWindow() {
+		if (window.empty()) {
+			return;
+		}
+
+		std::unique_lock<std::mutex> l(lock);
+		changed.wait(l, [&]() { return !hasPending; });
+
+		std::swap(window, pending);
+		pendingStart = windowStart;
+		hasPending = true;
+		windowStart += pending.size();
+		window.clear();
+
+		changed.notify_all();
+	}
+
+	//Waits for the writer thread to finish what it was given, after which the file, the CRC and
+	//the hash state can be used from this thread
+	void drain() {
+		std::unique_lock<std::mutex> l(lock);
+		changed.wait(l, [&]() { return !hasPending; });
+	}
+
+	void writerLoop() {
+		std::unique_lock<std::mutex> l(lock);
+		while (true) {
+			changed.wait(l, [&]() { return hasPending || stopping; });
+			if (!hasPending) {
+				return;
+			}
+
+			l.unlock();
+			emit(pendingStart, pending.data(), pending.size());
+			l.lock();
+
+			hasPending = false;
+			changed.notify_all();
+		}
+	}
+
+	void stopWriter() {
+		if (!writer.joinable()) {
+			return;
+		}
+
+		flush();
+		{
+			std::lock_guard<std::mutex> l(lock);
+			stopping = true;
+		}
+		changed.notify_all();
+		writer.join();
+	}
+
+	void takeQueuedHashes() {
+		std::lock_guard<std::mutex> l(lock);
+		for (auto &&h : queuedHashes) {
+			hashes.emplace_back(h);
+		}
+		queuedHashes.clear();
+	}
+
+	//Appends to the file at the end of what's been emitted so far
+	void emit(size_t at, const u8 *data, size_t len) {
+		takeQueuedHashes();
+
+		while (len > 0 && !failed) {
+			size_t n = std::min(len, EMIT_SLICE);
+			addToChunkCrcs(data, n);
+			file.seekp(at);
+			file.write((const char*)data, n);
+			checkFile();
+			hashSlice(at, data, n);
+
+			at += n;
+			data += n;
+			len -= n;
+		}
+	}
+
+	//The part of [at, at + n) each hash covers, finishing the hashes whose range ends in it.
+	//Records show up here too, before their hash is done.
+	void hashSlice(size_t at, const u8 *data, size_t n) {
+		for (size_t i = 0; i < hashes.size();) {
+			auto &&h = hashes[i];
+
+			size_t from = std::max(h.recordAt, at);
+			size_t to = std::min(h.recordAt + sizeof(h.placeholder), at + n);
+			if (from < to) {
+				memcpy(h.placeholder + (from - h.recordAt), data + (from - at), to - from);
+			}
+
+			from = std::max(h.start, at);
+			to = std::min(h.start + h.size, at + n);
+			if (from < to) {
+				h.sha.update(data + (from - at), to - from);
+			}
+
+			if (h.start + h.size <= at + n) {
+				finishHash(h);
+				hashes.erase(hashes.begin() + i);
+			}
+			else {
+				++i;
+			}
+		}
+	}
+
+	//Writes the digest over its record, which is already on disk, and corrects the CRC of the
+	//chunk it's in. CRC32 is linear: the CRC of the chunk as it is now is the CRC it was written
+	//with, XOR the CRC of the bytes that changed (with zeros around them) over that of all zeros.
+	void finishHash(RangeHash &h) {
+		h.sha.finalize();
+		const u8 *digest = (const u8*)h.sha.digest;
+		memcpy(h.digest, digest, sizeof(h.sha.digest));
+
+		file.seekp(h.recordAt);
+		file.write(h.sha.digest, sizeof(h.sha.digest));
+		checkFile();
+
+		if (crcChunkSize == 0) {
+			return;
+		}
+
+		for (size_t done = 0; done < sizeof(h.sha.digest);) {
+			size_t at = h.recordAt + done;
+			size_t chunk = at / crcChunkSize;
+
+			CrcFix fix;
+			fix.offset = at % crcChunkSize;
+			fix.len = std::min(sizeof(h.sha.digest) - done, crcChunkSize - fix.offset);
+			for (size_t i = 0; i < fix.len; ++i) {
+				fix.delta[i] = h.placeholder[done + i] ^ digest[done + i];
+			}
+
+			if (chunk < chunkCrcs.size()) {
+				chunkCrcs[chunk] ^= crcChange(fix, crcChunkSize);
+			}
+			else {
+				runningFixes.emplace_back(fix);
+			}
+			done += fix.len;
+		}
+	}
+
+	//What changing the bytes at fix.offset by fix.delta does to the CRC of a chunk this long
+	u32 crcChange(const CrcFix &fix, size_t chunkLen) {
+		i32 after = (i32)(chunkLen - fix.offset - fix.len);
+		u32 changed = CRC::MemCrc32(fix.delta, (i32)fix.len);
+		u32 unchanged = CRC::MemCrc32(zeros.data(), (i32)fix.len);
+		changed = CRC::MemCrc32(zeros.data(), after, changed);
+		unchanged = CRC::MemCrc32(zeros.data(), after, unchanged);
+		return changed ^ unchanged;
+	}
+
+	void addToChunkCrcs(const u8 *data, size_t len) {
+		if (crcChunkSize == 0) {
+			return;
+		}
+
+		while (len > 0) {
+			size_t n = std::min(len, crcChunkSize - runningLen);
+			runningCrc = CRC::MemCrc32(data, (i32)n, runningCrc);
+			runningLen += n;
+			data += n;
+			len -= n;
+
+			if (runningLen == crcChunkSize) {
+				closeChunk();
+			}
+		}
+	}
+
+	void closeChunk() {
+		for (auto &&fix : runningFixes) {
+			runningCrc ^= crcChange(fix, runningLen);
+		}
+		runningFixes.clear();
+
+		chunkCrcs.emplace_back(runningCrc);
+		runningCrc = 0;
+		runningLen = 0;
+	}
+};
+
+//Thrown while loading data that doesn't hold together (truncated or corrupt files). path says
+//where, outermost first, e.g. "DLC/Songs/x/Meta_x.uexp > export 0 > Catagory".
+struct ParseError : std::runtime_error {
+	std::string path;
+	std::string detail;
+
+	ParseError(const std::string &path, const std::string &detail)
+		: std::runtime_error(path.empty() ? detail : path + ": " + detail), path(path), detail(detail) {}
+
+	//The same error, as seen from the record that contains the one that failed
+	ParseError within(const std::string &outer) const {
+		return ParseError(path.empty() ? outer : outer + " > " + path, detail);
+	}
+};
+
 struct DataBuffer {
+	//Where the bytes go (or come from). Views from setupFromHere() always go through their root.
+	enum class Sink : u8 {
+		Memory,   //A fixed block of memory: reading a loaded file, or writing somewhere that can't grow
+		Vector,   //A std::vector<u8> that grows as we write past the end
+		Counting, //Nothing is stored, writes only advance pos/size. Used to plan an output up front
+		File,     //Streamed to disk through a FileSink
+	};
+
 	bool loading = true;
+	Sink sink = Sink::Memory;
 	size_t pos = 0;
 	i32 size = 0;
 	u8* buffer = nullptr;
 	void *ctx_;
-	std::function<void(size_t)> resize;
 
-	bool watch_ = false;
-	struct WatchedValue {
-		u8 *data;
-		i32 size;
-		size_t buffer_pos;
+	std::vector<u8> *vector = nullptr;
+	FileSink *file = nullptr;
+	//Set when buffer points into a memory mapped file. Large payloads are loaded as views into it.
+	std::shared_ptr<MappedFile> mapping;
+
+	//SHA-1 over [start, start + size) of the output, stored into digest and over the hash written
+	//at recordAt once the range is complete. A file computes these as the data goes out.
+	struct HashFixup {
+		size_t start;
+		size_t size;
+		size_t recordAt;
+		u8 *digest;
 	};
-	std::vector<WatchedValue> watchedValues;
-
-	std::vector<std::function<void(DataBuffer &)>> finalizeFunctions;
-
-	struct DerivedBuffer {
-		DataBuffer *base = nullptr;
-		size_t offset = 0;
-	};
-	std::optional<DerivedBuffer> derivedBuffer;
-	
+	std::vector<HashFixup> hashFixups;
+
+	//Set on sub-buffers created through setupFromHere(). They read and write the root buffer's
+	//storage directly at an absolute offset, however deeply they are nested.
+	DataBuffer *root = nullptr;
+	size_t offset = 0;
+
+	//Has to be added before the record at recordAt is written, and the record has to come before
+	//the end of the range
+	void addHashFixup(size_t start, size_t size, size_t recordAt, u8 *digest) {
+		if (sink == Sink::File) {
+			file->hashInto(start, size, recordAt, digest);
+			return;
+		}
 
-	DataBuffer() {
-		resize = [](size_t) {
-			throw std::out_of_range("Cannot resize the buffer!");
-		};
+		HashFixup h;
+		h.start = start;
+		h.size = size;
+		h.recordAt = recordAt;
+		h.digest = digest;
+		hashFixups.emplace_back(h);
 	}
 
-	void watch(std::function<void()> fn) {
-		watch_ = true;
-		fn();
-		watch_ = false;
+	//Makes sure every hash added so far is computed and in its record. Anything that goes out
+	//with those hashes (an index listing them) has to be written after this.
+	void settleHashFixups() {
+		if (sink == Sink::File) {
+			file->flush();
+		}
+		else if (sink != Sink::Counting) {
+			for (auto &&h : hashFixups) {
+				SHA1 sha;
+				sha.reset();
+				sha.update(buffer + h.start, h.size);
+				sha.finalize();
+				memcpy(h.digest, sha.digest, sizeof(sha.digest));
+				memcpy(buffer + h.recordAt, sha.digest, sizeof(sha.digest));
+			}
+		}
+		hashFixups.clear();
 	}
 
 	void finalize() {
-		for (auto &&w : watchedValues) {
-			memcpy(buffer + w.buffer_pos, w.data, w.size);
-		}
-
-		for (auto &&f : finalizeFunctions) {
-			f(*this);
-		}
-		watchedValues.clear();
+		settleHashFixups();
 	}
 
 	DataBuffer setupFromHere() {
-		DerivedBuffer dB;
-		dB.base = this;
-		dB.offset = pos;
-
 		DataBuffer newBuffer;
 		newBuffer.buffer = nullptr;
 		newBuffer.pos = 0;
 		newBuffer.ctx_ = ctx_;
 		newBuffer.loading = loading;
+		newBuffer.sink = sink;
+		newBuffer.root = root ? root : this;
+		newBuffer.offset = offset + pos;
 		if (loading) {
 			newBuffer.size = size - pos;
 		}
 		else {
 			newBuffer.size = 0;
 		}
-		newBuffer.derivedBuffer = dB;
 
 		return newBuffer;
 	}
 
+	//Moves this buffer to the end of what a sub-buffer made with setupFromHere() went through
+	void skipPast(const DataBuffer &sub) {
+		pos = (sub.offset - offset) + sub.pos;
+	}
+
+	void setupMemory(const u8 *data, size_t dataSize) {
+		sink = Sink::Memory;
+		buffer = (u8*)data;
+		size = dataSize;
+	}
+
+	//Reading a part of a mapped file, e.g. one entry of a pak
+	void setupMemory(const u8 *data, size_t dataSize, std::shared_ptr<MappedFile> file) {
+		setupMemory(data, dataSize);
+		mapping = std::move(file);
+	}
+
+	void setupMapped(std::shared_ptr<MappedFile> file) {
+		setupMemory(file->data(), file->size(), file);
+	}
+
+	//The mapped file this buffer (or its root) reads from, if any
+	const std::shared_ptr<MappedFile> &mappedFile() const {
+		return root ? root->mapping : mapping;
+	}
+
 	void setupVector(std::vector<u8> &v) {
+		sink = Sink::Vector;
+		vector = &v;
 		buffer = v.data();
 		size = v.size();
-		resize = [&](size_t sz) {
-			v.resize(sz);
-			buffer = v.data();
-			size = sz;
-		};
+	}
+
+	//Saving something whose final size is already known (e.g. from a counting pass): the output is
+	//allocated once up front instead of growing as it's written
+	void reserve(size_t total) {
+		if (sink == Sink::Vector) {
+			vector->reserve(total);
+		}
+		else if (sink == Sink::File) {
+			file->reserve(total);
+		}
+	}
+
+	void setupCounting() {
+		loading = false;
+		sink = Sink::Counting;
+		buffer = nullptr;
+		size = 0;
+	}
+
+	void setupFile(FileSink &f) {
+		loading = false;
+		sink = Sink::File;
+		file = &f;
+		buffer = nullptr;
+		size = 0;
 	}
 
 	template<typename T>
@@ -98,74 +597,158 @@ struct DataBuffer {
 
 
 	void serialize(u8 *data, i32 data_size) {
-		if (derivedBuffer.has_value()) {
-			size_t prevPos = derivedBuffer->base->pos;
-			bool prevWatch = derivedBuffer->base->watch_;
-			
-			derivedBuffer->base->pos = pos + derivedBuffer->offset;
-			derivedBuffer->base->watch_ = watch_;
-			if (data_size < 0) {
-				data_size = data_size * -2;
-			}
-			derivedBuffer->base->serialize(data, data_size);
+		if (data_size > 1024) {
+			__debugbreak();
+		}
 
-			derivedBuffer->base->watch_ = prevWatch;
-			derivedBuffer->base->pos = prevPos;
+		serializeBlock(data, data_size);
+	}
+
+	//Like serialize(u8*, i32), but without the sanity limit on the size. Used to move whole
+	//ranges of trivially copyable elements at once instead of going through them one by one.
+	void serializeBlock(u8 *data, i32 data_size) {
+		if (root) {
+			root->serializeAt(offset + pos, data, data_size);
 
 			pos += data_size;
-			if (!loading && pos > size) {
-				size = pos;
+			if (!loading && pos > (size_t)size) {
+				size = (i32)pos;
 			}
-
 			return;
 		}
 
-		if (data_size > 1024) {
-			__debugbreak();
+		if (serializeAt(pos, data, data_size)) {
+			pos += data_size;
 		}
+	}
 
-		if (loading && pos + data_size > size) {
-			__debugbreak();
-			return;
+private:
+	bool serializeAt(size_t at, u8 *data, i32 data_size) {
+		if (loading) {
+			//What the value belongs to gets added by the callers, through ParseError::within
+			if (at + data_size > (size_t)size) {
+				throwOverrun("value", at, data_size);
+			}
+
+			memcpy(data, buffer + at, data_size);
+			return true;
 		}
 
 #ifdef _DEBUG
 		//constexpr u32 dbgpos = 78;
-		//if (!loading) {
-		//	if (pos <= dbgpos && pos + data_size > dbgpos) {
-		//		__debugbreak();
-		//	}
+		//if (at <= dbgpos && at + data_size > dbgpos) {
+		//	__debugbreak();
 		//}
 #endif
 
-		if (loading) {
-			memcpy(data, buffer + pos, data_size);
+		if (at + data_size <= (size_t)size && buffer) {
+			memcpy(buffer + at, data, data_size);
 		}
 		else {
-			//If we've seeked ahead, then write 0's until the new position
-			if (pos > size) {
-				u32 diff = (pos - size);
-				resize(size + diff);
-				memset(buffer + pos - diff, 0, diff);
+			writePastEnd(at, data, data_size);
+		}
+
+		return true;
+	}
+
+	//Slow path of a write: growing the output, or a sink without directly addressable memory
+	void writePastEnd(size_t at, const u8 *data, i32 data_size) {
+		size_t end = at + data_size;
+
+		switch (sink) {
+		case Sink::Memory:
+			throw std::out_of_range("Cannot resize the buffer!");
+		case Sink::Vector:
+			//If we've seeked ahead, resizing also writes 0's until the new position
+			if (end > vector->size()) {
+				vector->resize(end);
 			}
+			buffer = vector->data();
+			memcpy(buffer + at, data, data_size);
+			break;
+		case Sink::Counting:
+			break;
+		case Sink::File:
+			file->write(at, data, data_size);
+			break;
+		}
+
+		if (end > (size_t)size) {
+			size = (i32)end;
+		}
+	}
 
-			//Ensure size
-			if (pos + data_size > size) {
-				resize(pos + data_size);
+	[[noreturn]] void throwOverrun(const char *what, size_t at, size_t n) const {
+		const DataBuffer &r = root ? *root : *this;
+		throw ParseError(what, "reading " + std::to_string(n) + " bytes at offset " + std::to_string(at) +
+			" runs past the end of the data (" + std::to_string(r.size) + " bytes)");
+	}
+
+public:
+	//Bytes at the current read position, straight out of the loaded buffer. Throws a ParseError
+	//naming what was being read if fewer than n are left.
+	const u8 *readable(size_t n, const char *what) {
+		DataBuffer &r = root ? *root : *this;
+		size_t at = root ? offset + pos : pos;
+		if (at + n > (size_t)r.size) {
+			throwOverrun(what, at, n);
+		}
+
+		return r.buffer + at;
+	}
+
+	//Loading: makes sure n more bytes are there, see readable()
+	void require(size_t n, const char *what) {
+		if (loading) {
+			readable(n, what);
+		}
+	}
+
+	//Reads a fixed size record. The whole record is bounds checked once when the region is made, and
+	//its fields are then copied straight out of memory. When saving, it's the same as serializing
+	//each field.
+	struct Region {
+		DataBuffer &buffer;
+		const u8 *base;
+		size_t start;
+		size_t size;
+
+#ifdef _DEBUG
+		~Region() {
+			//The size given for the record doesn't match its fields. Not a mismatch if a field threw.
+			if (base && buffer.pos - start != size && std::uncaught_exceptions() == 0) {
+				__debugbreak();
 			}
+		}
+#endif
 
-			memcpy(buffer + pos, data, data_size);
+		template<typename T>
+		void operator()(T &data) {
+			if constexpr (is_bulk_serializable<T>::value) {
+				if (base) {
+					memcpy(&data, base + (buffer.pos - start), sizeof(T));
+					buffer.pos += sizeof(T);
+					return;
+				}
+			}
+			buffer.serialize(data);
+		}
 
-			if (watch_) {
-				WatchedValue v;
-				v.buffer_pos = pos;
-				v.data = data;
-				v.size = data_size;
-				watchedValues.emplace_back(v);
+		template<typename T, i32 N>
+		void operator()(T (&data)[N]) {
+			if constexpr (is_bulk_serializable<T>::value) {
+				if (base) {
+					memcpy(data, base + (buffer.pos - start), sizeof(data));
+					buffer.pos += sizeof(data);
+					return;
+				}
 			}
+			buffer.serialize(data);
 		}
+	};
 
-		pos += data_size;
+	Region region(size_t size, const char *what) {
+		return Region{ *this, loading ? readable(size, what) : nullptr, pos, size };
 	}
 
 	template<class T, class = void>
@@ -174,9 +757,61 @@ struct DataBuffer {
 	template<class T>
 	struct has_serialize<T, typename voider<decltype(std::declval<T>().serialize(std::declval<DataBuffer&>()))>::type> : std::true_type {};
 
+	template<class T, class = void>
+	struct has_fields : std::false_type {};
+
+	template<class T>
+	struct has_fields<T, typename voider<typename T::fields>::type> : std::true_type {};
+
+	//Types whose in-memory representation is exactly what gets written to disk, so a contiguous
+	//run of them can be copied in one go. Structs with a packed FieldList qualify automatically.
+	template<typename T, class = void>
+	struct is_bulk_serializable : std::bool_constant<(std::is_arithmetic_v<T> || std::is_enum_v<T>) && !std::is_same_v<T, bool>> {};
+
+	template<typename T>
+	static constexpr bool is_bulk_field() {
+		if constexpr (std::is_array_v<T>) {
+			return is_bulk_serializable<std::remove_all_extents_t<T>>::value;
+		}
+		else {
+			return is_bulk_serializable<T>::value;
+		}
+	}
+
+	template<typename T, auto... Members>
+	static constexpr bool packedFields(FieldList<Members...>*) {
+		return (is_bulk_field<std::remove_reference_t<decltype(std::declval<T&>().*Members)>>() && ...) &&
+			FieldList<Members...>::template fieldsSize<T>() == sizeof(T);
+	}
+
+	template<typename T>
+	struct is_bulk_serializable<T, std::enable_if_t<has_fields<T>::value>> : std::bool_constant<packedFields<T>((typename T::fields*)nullptr)> {};
+
+	template<typename T>
+	void serializeRange(T *data, i32 count) {
+		if constexpr (is_bulk_serializable<T>::value) {
+			if (count > 0) {
+				checkLayout(data[0]);
+				serializeBlock((u8*)data, count * (i32)sizeof(T));
+			}
+		}
+		else {
+			for (i32 i = 0; i < count; ++i) {
+				serialize(data[i]);
+			}
+		}
+	}
+
 	template<typename T>
 	void serialize(T& data) {
-		if constexpr (has_serialize<T>::value) {
+		if constexpr (has_fields<T>::value && is_bulk_serializable<T>::value) {
+			checkLayout(data);
+			serializeBlock((u8*)&data, sizeof(T));
+		}
+		else if constexpr (has_fields<T>::value) {
+			T::fields::forEach(data, [&](auto &field) { serialize(field); });
+		}
+		else if constexpr (has_serialize<T>::value) {
 			data.serialize(*this);
 		}
 		else if constexpr (std::is_fundamental_v<T>) {
@@ -186,15 +821,25 @@ struct DataBuffer {
 			serialize((u8*)&data, sizeof(std::underlying_type_t<T>));
 		}
 		else {
-			static_assert(false, "Unsupported type to serialize!");
+			static_assert(!std::is_same_v<T, T>, "Unsupported type to serialize!");
+		}
+	}
+
+	//Catches a FieldList that isn't in declaration order before it's copied as one block
+	template<typename T>
+	void checkLayout([[maybe_unused]] const T &data) {
+#ifdef _DEBUG
+		if constexpr (has_fields<T>::value) {
+			if (!T::fields::contiguous(data)) {
+				__debugbreak();
+			}
 		}
+#endif
 	}
 
 	template<typename T, i32 N>
 	void serialize(T (&data)[N]) {
-		for (i32 i = 0; i < N; ++i) {
-			serialize(data[i]);
-		}
+		serializeRange(data, N);
 	}
 
 	template<typename T>
@@ -203,24 +848,53 @@ struct DataBuffer {
 		serialize(size);
 
 		if (loading) {
+			requireCount<T>(size);
 			data.resize(size);
 		}
 
-		for (i32 i = 0; i < size; ++i) {
-			serialize(data[i]);
-		}
+		serializeRange(data.data(), size);
 	}
 
 	template<typename T>
 	void serializeWithSize(std::vector<T>& data, i32 size) {
 		if (loading) {
+			requireCount<T>(size);
 			data.resize(size);
 		}
 
-		for (i32 i = 0; i < size; ++i) {
-			serialize(data[i]);
+		serializeRange(data.data(), size);
+	}
+
+	//Catches garbage counts before they turn into a huge allocation
+	template<typename T>
+	void requireCount(i32 count) {
+		if (count < 0) {
+			throw ParseError("array", "negative element count " + std::to_string(count));
+		}
+		//Every element takes at least a byte
+		readable((size_t)count * (is_bulk_serializable<T>::value ? sizeof(T) : 1), "array");
+	}
+	void serializeWithSize(MappedBytes &data, i32 size) {
+		if (!loading) {
+			serializeBlock((u8*)data.data(), size);
+			return;
+		}
+
+		if (size < 0) {
+			throw ParseError("array", "negative size " + std::to_string(size));
 		}
+
+		auto &&file = mappedFile();
+		if (file && pos + size <= (size_t)this->size) {
+			const u8 *at = (root ? root->buffer + offset : buffer) + pos;
+			data.setView(file, at - file->data(), size);
+			pos += size;
+			return;
+		}
+
+		serializeWithSize(data.owned(), size);
 	}
+
 	template<typename T>
 	void serializeWithSize_nonull(std::vector<T>& data, i32 size) {
 		if (loading) {
@@ -232,118 +906,107 @@ struct DataBuffer {
 		}
 	}
 	void serialize(std::string& data) {
+		serializeString(data, true);
+	}
+	void serialize_nonull(std::string& data) {
+		serializeString(data, false);
+	}
+
+private:
+
+	//An FString: its length, then that many ANSI (Latin-1) chars if positive or UTF-16LE code units
+	//if negative. data is always UTF-8. When nullTerminated the length includes a terminator.
+	//Anything that isn't ASCII is written back out as UTF-16, like UE does.
+	void serializeString(std::string &data, bool nullTerminated) {
 		if (loading) {
-			i32 size = (i32)data.size();
-			i32 origSize = (i32)data.size();
+			i32 size = 0;
 			serialize(size);
-			if(size!=0){
-				if (size < 0) {
-					size = size * -2;
-					data.resize(size-2);
-					serialize((u8*)data.data(), size-2);
-					std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-					data = converter.to_bytes(
-						std::wstring(reinterpret_cast<const wchar_t*>(data.data()),
-							data.length() / sizeof(wchar_t)));
-	
-					pos += 2;
+			if (size == 0) {
+				data.clear();
+			}
+			else if (size > 0) {
+				i32 len = nullTerminated ? size - 1 : size;
+				const u8 *src = readable(size, "string");
+
+				//ANSI FStrings are Latin-1, anything past ASCII needs re-encoding
+				if (utf_convert::isAscii((const char*)src, len)) {
+					data.assign((const char*)src, len);
 				}
 				else {
-					data.resize(size - 1);
-					serialize((u8*)data.data(), size - 1);
-					pos += 1;
+					data.resize(utf_convert::latin1Utf8Length(src, len));
+					utf_convert::latin1ToUtf8(src, len, data.data());
 				}
-				
-			}
-
-		}
-		else {
-			if (data.size() == 0) {
-				u32 null = 0;
-				serialize(null);
+				pos += size;
 			}
 			else {
-				i32 size = data.size() + 1;
-				bool isUtf16 = false;
-				for (char c : data) {
-					if (c & 0x80) {
-						isUtf16 = true;
-					}
-				}
-				if (isUtf16) {
-					std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
-					
-					std::u16string utf16_str = converter.from_bytes(data);
-					std::vector<uint8_t> utf16_bytes(reinterpret_cast<const uint8_t*>(utf16_str.data()), reinterpret_cast<const uint8_t*>(utf16_str.data() + utf16_str.size()));
-					utf16_bytes.push_back(0);
-					utf16_bytes.push_back(0);
-					size = utf16_bytes.size()/2;
-					i32 newsize = 0 - size;
-					serialize(newsize);
-					serialize((u8*)utf16_bytes.data(), size*2);
-				}
-				else {
-					serialize(size);
-					serialize((u8*)data.data(), size);
+				size_t bytes = (size_t)-(i64)size * 2;
+				const u8 *src = readable(bytes, "string");
+
+				//Without a length that includes it, the terminator may still be there; it's not part of the string
+				size_t len = bytes;
+				if (nullTerminated || (len >= 2 && src[len - 2] == 0 && src[len - 1] == 0)) {
+					len -= 2;
 				}
-				
+
+				data.resize(utf_convert::utf8Length(src, len));
+				utf_convert::utf16ToUtf8(src, len, data.data());
+				pos += bytes;
 			}
 		}
+		else {
+			writeString(data.data(), data.size(), nullTerminated);
+		}
 	}
-	void serialize_nonull(std::string& data) {
-		if (loading) {
-			i32 size = (i32)data.size();
-			i32 origSize = (i32)data.size();
-			serialize(size);
-			if (size != 0) {
-				if (size < 0) {
-					size = size * -2;
-					data.resize(size);
-					serialize((u8*)data.data(), size);
-					std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-					data = converter.to_bytes(
-						std::wstring(reinterpret_cast<const wchar_t*>(data.data()),
-							data.length() / sizeof(wchar_t)));
-				}
-				else {
-					data.resize(size);
-					serialize((u8*)data.data(), size);
-				}
 
-			}
+public:
+	//Bytes writeString puts out for the same string and nullTerminated
+	static size_t stringSize(const char *data, size_t len, bool nullTerminated = true) {
+		if (len == 0) {
+			return sizeof(i32);
+		}
+		if (utf_convert::isAscii(data, len)) {
+			return sizeof(i32) + len + (nullTerminated ? 1 : 0);
+		}
+		return sizeof(i32) + (utf_convert::utf16Length(data, len) + 1) * 2;
+	}
 
+	//Writes an FString from UTF-8. When nullTerminated, data[len] must be the terminator, it's
+	//written out along with the string.
+	void writeString(const char *data, size_t len, bool nullTerminated) {
+		if (len == 0) {
+			u32 null = 0;
+			serialize(null);
+		}
+		else if (utf_convert::isAscii(data, len)) {
+			//The terminator is already right after the data
+			i32 size = (i32)len + (nullTerminated ? 1 : 0);
+			serialize(size);
+			serializeBlock((u8*)data, size);
 		}
 		else {
-			if (data.size() == 0) {
-				u32 null = 0;
-				serialize(null);
-			}
-			else {
-				i32 size = data.size();
-				bool isUtf16 = false;
-				for (char c : data) {
-					if (c & 0x80) {
-						isUtf16 = true;
-					}
-				}
-				if (isUtf16) {
-					std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
-
-					std::u16string utf16_str = converter.from_bytes(data);
-					std::vector<uint8_t> utf16_bytes(reinterpret_cast<const uint8_t*>(utf16_str.data()), reinterpret_cast<const uint8_t*>(utf16_str.data() + utf16_str.size()));
-					utf16_bytes.push_back(0);
-					utf16_bytes.push_back(0);
-					size = utf16_bytes.size() / 2;
-					i32 newsize = 0 - size;
-					serialize(newsize);
-					serialize((u8*)utf16_bytes.data(), size * 2);
-				}
-				else {
-					serialize(size);
-					serialize((u8*)data.data(), size);
-				}
+			//Non-ANSI strings get a terminator either way
+			i32 units = (i32)utf_convert::utf16Length(data, len) + 1;
+			i32 size = -units;
+			serialize(size);
 
+			u8 chunk[512];
+			i32 used = 0;
+			const char *p = data;
+			const char *end = p + len;
+			while (p < end) {
+				if (used + 4 > (i32)sizeof(chunk)) {
+					serializeBlock(chunk, used);
+					used = 0;
+				}
+				used += (i32)utf_convert::writeUtf16(utf_convert::readUtf8(p, end), chunk + used);
+			}
+			if (used + 2 > (i32)sizeof(chunk)) {
+				serializeBlock(chunk, used);
+				used = 0;
 			}
+			chunk[used++] = 0;
+			chunk[used++] = 0;
+			serializeBlock(chunk, used);
 		}
 	}
 };
\ No newline at end of file
@@ -1,4 +1,8 @@
 #include "sha1.h"
+#include "cpu_features.h"
+
+#include <atomic>
+#include <cstring>
 
 #ifndef ROL32
 #ifdef _MSC_VER
@@ -22,10 +26,221 @@
 #define _R3(v,w,x,y,z,i) { z+=(((w|x)&y)|(w&x))+SHABLK(i)+0x8F1BBCDC+ROL32(v,5); w=ROL32(w,30); }
 #define _R4(v,w,x,y,z,i) { z+=(w^x^y)+SHABLK(i)+0xCA62C1D6+ROL32(v,5); w=ROL32(w,30); }
 
+//The crypto extensions are only compiled in where the compiler already targets them (Apple silicon,
+//Windows on ARM, or -march=armv8-a+crypto), whether the CPU has them is still checked at runtime
+#if defined(CPU_ARM64) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO) || defined(_M_ARM64))
+#define SHA1_ARMV8
+#include <arm_neon.h>
+#endif
+
+typedef void (*BlockFn)(u32 *state, const u8 *data, size_t count);
 
-SHA1::SHA1() {
-	m_block = (SHA1_WORKSPACE_BLOCK*)m_workspace;
+typedef union
+{
+	u8  c[64];
+	u32 l[16];
+} SHA1_WORKSPACE_BLOCK;
+
+static void blocksScalar(u32 *state, const u8 *data, size_t count) {
+	SHA1_WORKSPACE_BLOCK workspace;
+	SHA1_WORKSPACE_BLOCK *m_block = &workspace;
+
+	for (; count > 0; --count, data += 64) {
+		// Copy state[] to working vars
+		u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+		memcpy(m_block, data, 64);
+
+		// 4 rounds of 20 operations each. Loop unrolled.
+		_R0(a, b, c, d, e, 0); _R0(e, a, b, c, d, 1); _R0(d, e, a, b, c, 2); _R0(c, d, e, a, b, 3);
+		_R0(b, c, d, e, a, 4); _R0(a, b, c, d, e, 5); _R0(e, a, b, c, d, 6); _R0(d, e, a, b, c, 7);
+		_R0(c, d, e, a, b, 8); _R0(b, c, d, e, a, 9); _R0(a, b, c, d, e, 10); _R0(e, a, b, c, d, 11);
+		_R0(d, e, a, b, c, 12); _R0(c, d, e, a, b, 13); _R0(b, c, d, e, a, 14); _R0(a, b, c, d, e, 15);
+		_R1(e, a, b, c, d, 16); _R1(d, e, a, b, c, 17); _R1(c, d, e, a, b, 18); _R1(b, c, d, e, a, 19);
+		_R2(a, b, c, d, e, 20); _R2(e, a, b, c, d, 21); _R2(d, e, a, b, c, 22); _R2(c, d, e, a, b, 23);
+		_R2(b, c, d, e, a, 24); _R2(a, b, c, d, e, 25); _R2(e, a, b, c, d, 26); _R2(d, e, a, b, c, 27);
+		_R2(c, d, e, a, b, 28); _R2(b, c, d, e, a, 29); _R2(a, b, c, d, e, 30); _R2(e, a, b, c, d, 31);
+		_R2(d, e, a, b, c, 32); _R2(c, d, e, a, b, 33); _R2(b, c, d, e, a, 34); _R2(a, b, c, d, e, 35);
+		_R2(e, a, b, c, d, 36); _R2(d, e, a, b, c, 37); _R2(c, d, e, a, b, 38); _R2(b, c, d, e, a, 39);
+		_R3(a, b, c, d, e, 40); _R3(e, a, b, c, d, 41); _R3(d, e, a, b, c, 42); _R3(c, d, e, a, b, 43);
+		_R3(b, c, d, e, a, 44); _R3(a, b, c, d, e, 45); _R3(e, a, b, c, d, 46); _R3(d, e, a, b, c, 47);
+		_R3(c, d, e, a, b, 48); _R3(b, c, d, e, a, 49); _R3(a, b, c, d, e, 50); _R3(e, a, b, c, d, 51);
+		_R3(d, e, a, b, c, 52); _R3(c, d, e, a, b, 53); _R3(b, c, d, e, a, 54); _R3(a, b, c, d, e, 55);
+		_R3(e, a, b, c, d, 56); _R3(d, e, a, b, c, 57); _R3(c, d, e, a, b, 58); _R3(b, c, d, e, a, 59);
+		_R4(a, b, c, d, e, 60); _R4(e, a, b, c, d, 61); _R4(d, e, a, b, c, 62); _R4(c, d, e, a, b, 63);
+		_R4(b, c, d, e, a, 64); _R4(a, b, c, d, e, 65); _R4(e, a, b, c, d, 66); _R4(d, e, a, b, c, 67);
+		_R4(c, d, e, a, b, 68); _R4(b, c, d, e, a, 69); _R4(a, b, c, d, e, 70); _R4(e, a, b, c, d, 71);
+		_R4(d, e, a, b, c, 72); _R4(c, d, e, a, b, 73); _R4(b, c, d, e, a, 74); _R4(a, b, c, d, e, 75);
+		_R4(e, a, b, c, d, 76); _R4(d, e, a, b, c, 77); _R4(c, d, e, a, b, 78); _R4(b, c, d, e, a, 79);
+
+		// Add the working vars back into state
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+#ifdef CPU_X86
+//Four rounds per step with the SHA extensions. Step g finishes the schedule for step g + 1 (msg2),
+//carries on step g + 2's (xor) and starts step g + 3's (msg1), each only while it's still needed.
+#define SHANI_STEP(g, eIn, eOut) \
+	eIn = (g) == 0 ? _mm_add_epi32(eIn, msg[0]) : _mm_sha1nexte_epu32(eIn, msg[(g) & 3]); \
+	eOut = abcd; \
+	if ((g) >= 3 && (g) <= 18) msg[((g) + 1) & 3] = _mm_sha1msg2_epu32(msg[((g) + 1) & 3], msg[(g) & 3]); \
+	abcd = _mm_sha1rnds4_epu32(abcd, eIn, (g) / 5); \
+	if ((g) >= 1 && (g) <= 16) msg[((g) + 3) & 3] = _mm_sha1msg1_epu32(msg[((g) + 3) & 3], msg[(g) & 3]); \
+	if ((g) >= 2 && (g) <= 17) msg[((g) + 2) & 3] = _mm_xor_si128(msg[((g) + 2) & 3], msg[(g) & 3]);
+
+CPU_TARGET("sha,sse4.1,ssse3")
+static void blocksShaNi(u32 *state, const u8 *data, size_t count) {
+	const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ull, 0x08090a0b0c0d0e0full);
+
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+	__m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+	__m128i e1;
+
+	for (; count > 0; --count, data += 64) {
+		__m128i abcdSaved = abcd;
+		__m128i e0Saved = e0;
+
+		__m128i msg[4];
+		for (int i = 0; i < 4; ++i) {
+			msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), byteSwap);
+		}
+
+		SHANI_STEP(0, e0, e1);  SHANI_STEP(1, e1, e0);  SHANI_STEP(2, e0, e1);  SHANI_STEP(3, e1, e0);
+		SHANI_STEP(4, e0, e1);  SHANI_STEP(5, e1, e0);  SHANI_STEP(6, e0, e1);  SHANI_STEP(7, e1, e0);
+		SHANI_STEP(8, e0, e1);  SHANI_STEP(9, e1, e0);  SHANI_STEP(10, e0, e1); SHANI_STEP(11, e1, e0);
+		SHANI_STEP(12, e0, e1); SHANI_STEP(13, e1, e0); SHANI_STEP(14, e0, e1); SHANI_STEP(15, e1, e0);
+		SHANI_STEP(16, e0, e1); SHANI_STEP(17, e1, e0); SHANI_STEP(18, e0, e1); SHANI_STEP(19, e1, e0);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0Saved);
+		abcd = _mm_add_epi32(abcd, abcdSaved);
+	}
+
+	_mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = (u32)_mm_extract_epi32(e0, 3);
+}
+#endif
+
+#ifdef SHA1_ARMV8
+static const u32 ROUND_CONSTANTS[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+//Four rounds per step with the ARMv8 crypto extensions. Step g adds the constants for step g + 2,
+//finishes the schedule for step g + 3 (su1) and starts step g + 4's (su0).
+#define ARMV8_STEP(g, eIn, eOut) \
+	eOut = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+	abcd = (g) < 5 ? vsha1cq_u32(abcd, eIn, tmp[(g) & 1]) : \
+		(g) < 10 || (g) >= 15 ? vsha1pq_u32(abcd, eIn, tmp[(g) & 1]) : vsha1mq_u32(abcd, eIn, tmp[(g) & 1]); \
+	if ((g) <= 17) tmp[(g) & 1] = vaddq_u32(msg[((g) + 2) & 3], vdupq_n_u32(ROUND_CONSTANTS[((g) + 2) / 5])); \
+	if ((g) >= 1 && (g) <= 16) msg[((g) + 3) & 3] = vsha1su1q_u32(msg[((g) + 3) & 3], msg[((g) + 2) & 3]); \
+	if ((g) <= 15) msg[(g) & 3] = vsha1su0q_u32(msg[(g) & 3], msg[((g) + 1) & 3], msg[((g) + 2) & 3]);
+
+static void blocksArmV8(u32 *state, const u8 *data, size_t count) {
+	uint32x4_t abcd = vld1q_u32(state);
+	u32 e0 = state[4];
+	u32 e1;
+
+	for (; count > 0; --count, data += 64) {
+		uint32x4_t abcdSaved = abcd;
+		u32 e0Saved = e0;
+
+		uint32x4_t msg[4];
+		for (int i = 0; i < 4; ++i) {
+			msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+		}
+
+		uint32x4_t tmp[2];
+		tmp[0] = vaddq_u32(msg[0], vdupq_n_u32(ROUND_CONSTANTS[0]));
+		tmp[1] = vaddq_u32(msg[1], vdupq_n_u32(ROUND_CONSTANTS[0]));
+
+		ARMV8_STEP(0, e0, e1);  ARMV8_STEP(1, e1, e0);  ARMV8_STEP(2, e0, e1);  ARMV8_STEP(3, e1, e0);
+		ARMV8_STEP(4, e0, e1);  ARMV8_STEP(5, e1, e0);  ARMV8_STEP(6, e0, e1);  ARMV8_STEP(7, e1, e0);
+		ARMV8_STEP(8, e0, e1);  ARMV8_STEP(9, e1, e0);  ARMV8_STEP(10, e0, e1); ARMV8_STEP(11, e1, e0);
+		ARMV8_STEP(12, e0, e1); ARMV8_STEP(13, e1, e0); ARMV8_STEP(14, e0, e1); ARMV8_STEP(15, e1, e0);
+		ARMV8_STEP(16, e0, e1); ARMV8_STEP(17, e1, e0); ARMV8_STEP(18, e0, e1); ARMV8_STEP(19, e1, e0);
+
+		e0 += e0Saved;
+		abcd = vaddq_u32(abcd, abcdSaved);
+	}
+
+	vst1q_u32(state, abcd);
+	state[4] = e0;
+}
+#endif
+
+bool SHA1::supported(Impl impl) {
+	switch (impl) {
+	case Impl::Scalar:
+		return true;
+#ifdef CPU_X86
+	case Impl::ShaNi:
+		return cpu::x86().ssse3 && cpu::x86().sse41 && cpu::x86().sha;
+#endif
+#ifdef SHA1_ARMV8
+	case Impl::ArmV8:
+		return cpu::arm().sha1;
+#endif
+	default:
+		return false;
+	}
+}
+
+static BlockFn blockFunction(SHA1::Impl impl) {
+	switch (impl) {
+#ifdef CPU_X86
+	case SHA1::Impl::ShaNi:
+		return blocksShaNi;
+#endif
+#ifdef SHA1_ARMV8
+	case SHA1::Impl::ArmV8:
+		return blocksArmV8;
+#endif
+	default:
+		return blocksScalar;
+	}
+}
+
+static SHA1::Impl fastestImpl() {
+	for (auto impl : { SHA1::Impl::ShaNi, SHA1::Impl::ArmV8 }) {
+		if (SHA1::supported(impl)) {
+			return impl;
+		}
+	}
+	return SHA1::Impl::Scalar;
+}
+
+//Entries get hashed from several threads at once, so the choice is made once and then only read
+static std::atomic<SHA1::Impl> &activeImpl() {
+	static std::atomic<SHA1::Impl> impl{ fastestImpl() };
+	return impl;
+}
+
+SHA1::Impl SHA1::implementation() {
+	return activeImpl().load(std::memory_order_relaxed);
+}
+
+bool SHA1::setImplementation(Impl impl) {
+	if (!supported(impl)) {
+		return false;
+	}
 
+	activeImpl().store(impl, std::memory_order_relaxed);
+	return true;
+}
+
+const char *SHA1::name(Impl impl) {
+	switch (impl) {
+	case Impl::Scalar: return "scalar";
+	case Impl::ShaNi: return "SHA-NI";
+	case Impl::ArmV8: return "ARMv8";
+	}
+	return "?";
+}
+
+SHA1::SHA1() {
 	reset();
 }
 
@@ -54,9 +269,12 @@ void SHA1::update(const u8 *data, u64 len) {
 	{
 		i = 64 - j;
 		memcpy(&m_buffer[j], data, i);
-		transform(m_state, m_buffer);
+		BlockFn blocks = blockFunction(implementation());
+		blocks(m_state, m_buffer, 1);
 
-		for (; i + 63 < len; i += 64) transform(m_state, &data[i]);
+		size_t whole = (len - i) / 64;
+		blocks(m_state, &data[i], whole);
+		i += whole * 64;
 
 		j = 0;
 	}
@@ -88,39 +306,3 @@ void SHA1::finalize() {
 		digest[i] = (u8)((m_state[i >> 2] >> ((3 - (i & 3)) * 8)) & 255);
 	}
 }
-
-void SHA1::transform(u32 *state, const u8 *buffer) {
-	// Copy state[] to working vars
-	u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
-
-	memcpy(m_block, buffer, 64);
-
-	// 4 rounds of 20 operations each. Loop unrolled.
-	_R0(a, b, c, d, e, 0); _R0(e, a, b, c, d, 1); _R0(d, e, a, b, c, 2); _R0(c, d, e, a, b, 3);
-	_R0(b, c, d, e, a, 4); _R0(a, b, c, d, e, 5); _R0(e, a, b, c, d, 6); _R0(d, e, a, b, c, 7);
-	_R0(c, d, e, a, b, 8); _R0(b, c, d, e, a, 9); _R0(a, b, c, d, e, 10); _R0(e, a, b, c, d, 11);
-	_R0(d, e, a, b, c, 12); _R0(c, d, e, a, b, 13); _R0(b, c, d, e, a, 14); _R0(a, b, c, d, e, 15);
-	_R1(e, a, b, c, d, 16); _R1(d, e, a, b, c, 17); _R1(c, d, e, a, b, 18); _R1(b, c, d, e, a, 19);
-	_R2(a, b, c, d, e, 20); _R2(e, a, b, c, d, 21); _R2(d, e, a, b, c, 22); _R2(c, d, e, a, b, 23);
-	_R2(b, c, d, e, a, 24); _R2(a, b, c, d, e, 25); _R2(e, a, b, c, d, 26); _R2(d, e, a, b, c, 27);
-	_R2(c, d, e, a, b, 28); _R2(b, c, d, e, a, 29); _R2(a, b, c, d, e, 30); _R2(e, a, b, c, d, 31);
-	_R2(d, e, a, b, c, 32); _R2(c, d, e, a, b, 33); _R2(b, c, d, e, a, 34); _R2(a, b, c, d, e, 35);
-	_R2(e, a, b, c, d, 36); _R2(d, e, a, b, c, 37); _R2(c, d, e, a, b, 38); _R2(b, c, d, e, a, 39);
-	_R3(a, b, c, d, e, 40); _R3(e, a, b, c, d, 41); _R3(d, e, a, b, c, 42); _R3(c, d, e, a, b, 43);
-	_R3(b, c, d, e, a, 44); _R3(a, b, c, d, e, 45); _R3(e, a, b, c, d, 46); _R3(d, e, a, b, c, 47);
-	_R3(c, d, e, a, b, 48); _R3(b, c, d, e, a, 49); _R3(a, b, c, d, e, 50); _R3(e, a, b, c, d, 51);
-	_R3(d, e, a, b, c, 52); _R3(c, d, e, a, b, 53); _R3(b, c, d, e, a, 54); _R3(a, b, c, d, e, 55);
-	_R3(e, a, b, c, d, 56); _R3(d, e, a, b, c, 57); _R3(c, d, e, a, b, 58); _R3(b, c, d, e, a, 59);
-	_R4(a, b, c, d, e, 60); _R4(e, a, b, c, d, 61); _R4(d, e, a, b, c, 62); _R4(c, d, e, a, b, 63);
-	_R4(b, c, d, e, a, 64); _R4(a, b, c, d, e, 65); _R4(e, a, b, c, d, 66); _R4(d, e, a, b, c, 67);
-	_R4(c, d, e, a, b, 68); _R4(b, c, d, e, a, 69); _R4(a, b, c, d, e, 70); _R4(e, a, b, c, d, 71);
-	_R4(d, e, a, b, c, 72); _R4(c, d, e, a, b, 73); _R4(b, c, d, e, a, 74); _R4(a, b, c, d, e, 75);
-	_R4(e, a, b, c, d, 76); _R4(d, e, a, b, c, 77); _R4(c, d, e, a, b, 78); _R4(b, c, d, e, a, 79);
-
-	// Add the working vars back into state
-	state[0] += a;
-	state[1] += b;
-	state[2] += c;
-	state[3] += d;
-	state[4] += e;
-}
\ No newline at end of file
@@ -4,26 +4,29 @@
 struct SHA1 {
 	char digest[20];
 
+	//Ways to run the block function. The fastest one the CPU supports is picked on first use.
+	enum class Impl {
+		Scalar,
+		ShaNi,
+		ArmV8,
+	};
+
 	SHA1();
 
 	void reset();
 	void update(const u8 *data, u64 len);
 	void finalize();
 
+	static Impl implementation();
+	//For benchmarks and checking the fast paths against Scalar. False if the CPU can't run impl.
+	static bool setImplementation(Impl impl);
+	static bool supported(Impl impl);
+	static const char *name(Impl impl);
+
 private:
 	u32 m_state[5];
 	u32 m_count[2];
 	u32 __reserved1[1];
 	u8  m_buffer[64];
 	u32 __reserved2[3];
-
-	u8 m_workspace[64];
-	typedef union
-	{
-		u8  c[64];
-		u32 l[16];
-	} SHA1_WORKSPACE_BLOCK;
-	SHA1_WORKSPACE_BLOCK *m_block;
-
-	void transform(u32 *state, const u8 *buffer);
-};
\ No newline at end of file
+};
@@ -1,149 +1,132 @@
 #include "uasset.h"
 
+#include <array>
+
 namespace asset_helper {
-	PropertyValue createPropertyValue(const std::string &type, const bool useUnknown) {
-		if (type == "BoolProperty") {
-			return BoolProperty{};
-		}
-		else if (type == "Int8Property") {
-			return PrimitiveProperty<i8>{};
-		}
-		else if (type == "Int16Property") {
-			return PrimitiveProperty<i16>{};
-		}
-		else if (type == "IntProperty") {
-			return PrimitiveProperty<i32>{};
-		}
-		else if (type == "Int64Property") {
-			return PrimitiveProperty<i64>{};
-		}
-		else if (type == "UInt16Property") {
-			return PrimitiveProperty<u16>{};
-		}
-		else if (type == "UInt32Property") {
-			return PrimitiveProperty<u32>{};
-		}
-		else if (type == "UInt64Property") {
-			return PrimitiveProperty<u64>{};
-		}
-		else if (type == "FloatProperty") {
-			return PrimitiveProperty<float>{};
+	template<class T, size_t I = 0>
+	constexpr size_t variantIndex() {
+		if constexpr (std::is_same_v<std::variant_alternative_t<I, PropertyValue>, T>) {
+			return I;
 		}
-		else if (type == "TextProperty") {
-			return TextProperty{};
-		}
-		else if (type == "StrProperty") {
-			return StringProperty{};
-		}
-		else if (type == "ObjectProperty") {
-			return ObjectProperty{};
-		}
-		else if (type == "EnumProperty") {
-			return EnumProperty{};
-		}
-		else if (type == "ByteProperty") {
-			return ByteProperty{};
-		}
-		else if (type == "NameProperty") {
-			return NameProperty{};
+		else {
+			return variantIndex<T, I + 1>();
 		}
-		else if (type == "ArrayProperty") {
-			return ArrayProperty{};
+	}
+
+	static const size_t VALUE_TYPE_COUNT = std::variant_size_v<PropertyValue>;
+
+	struct PropertyTypeName {
+		std::string_view name;
+		size_t index;
+	};
+
+	//Serialized type name of every alternative that can be created by name
+	constexpr PropertyTypeName PROPERTY_TYPES[] = {
+		{ "BoolProperty", variantIndex<BoolProperty>() },
+		{ "Int8Property", variantIndex<PrimitiveProperty<i8>>() },
+		{ "Int16Property", variantIndex<PrimitiveProperty<i16>>() },
+		{ "IntProperty", variantIndex<PrimitiveProperty<i32>>() },
+		{ "Int64Property", variantIndex<PrimitiveProperty<i64>>() },
+		{ "UInt16Property", variantIndex<PrimitiveProperty<u16>>() },
+		{ "UInt32Property", variantIndex<PrimitiveProperty<u32>>() },
+		{ "UInt64Property", variantIndex<PrimitiveProperty<u64>>() },
+		{ "FloatProperty", variantIndex<PrimitiveProperty<float>>() },
+		{ "TextProperty", variantIndex<TextProperty>() },
+		{ "StrProperty", variantIndex<StringProperty>() },
+		{ "ObjectProperty", variantIndex<ObjectProperty>() },
+		{ "EnumProperty", variantIndex<EnumProperty>() },
+		{ "ByteProperty", variantIndex<ByteProperty>() },
+		{ "NameProperty", variantIndex<NameProperty>() },
+		{ "ArrayProperty", variantIndex<ArrayProperty>() },
+		{ "MapProperty", variantIndex<MapProperty>() },
+		{ "StructProperty", variantIndex<StructProperty>() },
+		{ "Guid", variantIndex<PrimitiveProperty<Guid>>() },
+		{ "SoftObjectProperty", variantIndex<SoftObjectProperty>() },
+		{ "DateTime", variantIndex<DateTime>() },
+	};
+
+	constexpr u32 hashTypeName(std::string_view name) {
+		u32 hash = 2166136261u;
+		for (char c : name) {
+			hash = (hash ^ (u8)c) * 16777619u;
+		}
+		return hash;
+	}
+
+	//Open addressed table of PROPERTY_TYPES indices, sized so lookups almost never probe past the
+	//first slot. Built at compile time, so adding a type only means adding it to PROPERTY_TYPES.
+	struct PropertyTypeSlots {
+		static const size_t SIZE = 64;
+		i8 slots[SIZE];
+	};
+
+	constexpr PropertyTypeSlots buildTypeSlots() {
+		PropertyTypeSlots table{};
+		for (size_t i = 0; i < PropertyTypeSlots::SIZE; ++i) {
+			table.slots[i] = -1;
 		}
-		else if (type == "MapProperty") {
-			return MapProperty{};
+
+		for (size_t i = 0; i < std::size(PROPERTY_TYPES); ++i) {
+			size_t slot = hashTypeName(PROPERTY_TYPES[i].name) % PropertyTypeSlots::SIZE;
+			while (table.slots[slot] != -1) {
+				slot = (slot + 1) % PropertyTypeSlots::SIZE;
+			}
+			table.slots[slot] = (i8)i;
 		}
-		else if (type == "StructProperty") {
-			return StructProperty{};
+		return table;
+	}
+
+	constexpr PropertyTypeSlots TYPE_SLOTS = buildTypeSlots();
+
+	template<size_t I>
+	PropertyValue createAlternative() {
+		return PropertyValue(std::in_place_index<I>);
+	}
+
+	template<size_t... I>
+	constexpr std::array<PropertyValue(*)(), sizeof...(I)> makeCreators(std::index_sequence<I...>) {
+		return { { &createAlternative<I>... } };
+	}
+
+	constexpr auto CREATORS = makeCreators(std::make_index_sequence<VALUE_TYPE_COUNT>());
+
+	constexpr std::array<std::string_view, VALUE_TYPE_COUNT> makeTypeNames() {
+		std::array<std::string_view, VALUE_TYPE_COUNT> names{};
+		for (size_t i = 0; i < VALUE_TYPE_COUNT; ++i) {
+			names[i] = "UnknownProperty";
 		}
-		else if (type == "Guid") {
-			return PrimitiveProperty<Guid>{};
+		for (auto &&t : PROPERTY_TYPES) {
+			names[t.index] = t.name;
 		}
-		else if (type == "SoftObjectProperty") {
-			return SoftObjectProperty{};
+		return names;
+	}
+
+	constexpr auto TYPE_NAMES = makeTypeNames();
+
+	PropertyValue createPropertyValue(std::string_view type, Arena *structArena) {
+		for (size_t slot = hashTypeName(type) % PropertyTypeSlots::SIZE; TYPE_SLOTS.slots[slot] != -1; slot = (slot + 1) % PropertyTypeSlots::SIZE) {
+			auto &&t = PROPERTY_TYPES[TYPE_SLOTS.slots[slot]];
+			if (t.name == type) {
+				return CREATORS[t.index]();
+			}
 		}
-		else if (type == "DateTime") {
-			return DateTime{};
+
+		if (structArena) {
+			return structArena->make<IPropertyDataList>();
 		}
 		else {
-			if (useUnknown) {
-				printf("Unknown type %s!\n", type.c_str());
-				return UnknownProperty{};
-			}
-			else {
-				return new IPropertyDataList();
-			}
+			printf("Unknown type %.*s!\n", (int)type.size(), type.data());
+			return UnknownProperty{};
 		}
 	}
 
 	std::string getTypeForValue(const PropertyValue &v) {
-		if (std::holds_alternative<BoolProperty>(v)) {
-			return "BoolProperty";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<i8>>(v)) {
-			return "Int8Property";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<i16>>(v)) {
-			return "Int16Property";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<i32>>(v)) {
-			return "IntProperty";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<i64>>(v)) {
-			return "Int64Property";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<u16>>(v)) {
-			return "UInt16Property";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<u32>>(v)) {
-			return "UInt32Property";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<u64>>(v)) {
-			return "UInt64Property";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<float>>(v)) {
-			return "FloatProperty";
-		}
-		else if (std::holds_alternative<TextProperty>(v)) {
-			return "TextProperty";
-		}
-		else if (std::holds_alternative<StringProperty>(v)) {
-			return "StrProperty";
-		}
-		else if (std::holds_alternative<ObjectProperty>(v)) {
-			return "ObjectProperty";
-		}
-		else if (std::holds_alternative<EnumProperty>(v)) {
-			return "EnumProperty";
-		}
-		else if (std::holds_alternative<ByteProperty>(v)) {
-			return "ByteProperty";
-		}
-		else if (std::holds_alternative<ArrayProperty>(v)) {
-			return "ArrayProperty";
-		}
-		else if (std::holds_alternative<MapProperty>(v)) {
-			return "MapProperty";
-		}
-		else if (std::holds_alternative<StructProperty>(v)) {
-			return "StructProperty";
-		}
-		else if (std::holds_alternative<PrimitiveProperty<Guid>>(v)) {
-			return "Guid";
-		}
-		else if (std::holds_alternative<SoftObjectProperty>(v)) {
-			return "SoftObjectProperty";
-		}
-		else if (std::holds_alternative<DateTime>(v)) {
-			return "DateTime";
-		}
-		else if (std::holds_alternative<IPropertyDataList*>(v)) {
+		if (std::holds_alternative<IPropertyDataList*>(v)) {
 			printf("ERROR! This type is meant to be internal, never serialized out!");
 			return "";
 		}
-		else {
-			return "UnknownProperty";
-		}
+
+		return std::string(TYPE_NAMES[v.index()]);
 	}
 
 	template<class T, class = void>
@@ -173,7 +156,7 @@ namespace asset_helper {
 				buffer.serialize(*v);
 			}
 			else {
-				static_assert(false, "Unable to serialize!");
+				static_assert(!std::is_same_v<T, T>, "Unable to serialize!");
 			}
 		}, value);
 	}
@@ -184,11 +167,15 @@ namespace asset_helper {
 	template<class T>
 	struct has_length<T, typename voider<decltype(T::needs_length)>::type> : std::true_type {};
 
+	template<size_t... I>
+	constexpr std::array<bool, sizeof...(I)> makeNeedsLength(std::index_sequence<I...>) {
+		return { { has_length<std::variant_alternative_t<I, PropertyValue>>::value... } };
+	}
+
+	constexpr auto NEEDS_LENGTH = makeNeedsLength(std::make_index_sequence<VALUE_TYPE_COUNT>());
+
 	bool needsLength(const PropertyValue &value) {
-		return std::visit([&](auto &&v) {
-			using T = std::decay_t<decltype(v)>;
-			return has_length<T>::value;
-		}, value);
+		return NEEDS_LENGTH[value.index()];
 	}
 
 
@@ -208,13 +195,6 @@ namespace asset_helper {
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-ArrayProperty::~ArrayProperty() {
-	for (auto &&ptr : values) {
-		asset_helper::PropertyValue *value = (asset_helper::PropertyValue *)ptr;
-		delete value;
-	}
-}
-
 void ArrayProperty::serialize(DataBuffer &buffer) {
 	bool parseHeader = buffer.ctx<AssetCtx>().parseHeader;
 	if (parseHeader) {
@@ -233,8 +213,8 @@ void ArrayProperty::serialize(DataBuffer &buffer) {
 
 		values.resize(size);
 		for (i32 i = 0; i < size; ++i) {
-			IPropertyValue *value = new IPropertyValue();
-			std::string valueType = buffer.ctx<AssetCtx>().parsingSaveFormat ? arrayType.str : arrayType.getString(*buffer.ctx<AssetCtx>().header);
+			IPropertyValue *value = buffer.ctx<AssetCtx>().nodeArena().make<IPropertyValue>();
+			std::string_view valueType = buffer.ctx<AssetCtx>().parsingSaveFormat ? std::string_view(arrayType.str) : arrayType.getString(*buffer.ctx<AssetCtx>().header);
 			value->v = asset_helper::createPropertyValue(valueType);
 
 			buffer.ctx<AssetCtx>().parseHeader = false;
@@ -276,16 +256,22 @@ void StructProperty::serialize(DataBuffer &buffer) {
 		auto currentPos = buffer.pos;
 
 		do {
-			IPropertyValue *value = new IPropertyValue();
+			IPropertyValue *value = buffer.ctx<AssetCtx>().nodeArena().make<IPropertyValue>();
 
-			std::string typeStr = buffer.ctx<AssetCtx>().parsingSaveFormat ? type.str : type.getString(*buffer.ctx<AssetCtx>().header);
-			value->v = asset_helper::createPropertyValue(typeStr, false);
+			std::string_view typeStr = buffer.ctx<AssetCtx>().parsingSaveFormat ? std::string_view(type.str) : type.getString(*buffer.ctx<AssetCtx>().header);
+			value->v = asset_helper::createPropertyValue(typeStr, &buffer.ctx<AssetCtx>().nodeArena());
 
+			size_t valueStart = buffer.pos;
 			buffer.ctx<AssetCtx>().parseHeader = false;
 			asset_helper::serialize(buffer, 0, value->v);
 			buffer.ctx<AssetCtx>().parseHeader = parseHeader;
 
 			values.emplace_back(value);
+
+			//A bad length would otherwise keep us here forever
+			if (buffer.pos == valueStart) {
+				throw ParseError("StructProperty", "value of type " + std::string(typeStr) + " is empty");
+			}
 		} while ((buffer.pos - currentPos) < len);
 	}
 	else {
@@ -325,8 +311,8 @@ void MapProperty::serialize(DataBuffer &buffer) {
 
 			//Key
 			{
-				IPropertyValue *key = new IPropertyValue();
-				std::string keyTypeStr = buffer.ctx<AssetCtx>().parsingSaveFormat ? keyType.str : keyType.getString(*buffer.ctx<AssetCtx>().header);
+				IPropertyValue *key = buffer.ctx<AssetCtx>().nodeArena().make<IPropertyValue>();
+				std::string_view keyTypeStr = buffer.ctx<AssetCtx>().parsingSaveFormat ? std::string_view(keyType.str) : keyType.getString(*buffer.ctx<AssetCtx>().header);
 				key->v = asset_helper::createPropertyValue(keyTypeStr);
 
 				buffer.ctx<AssetCtx>().parseHeader = false;
@@ -338,8 +324,8 @@ void MapProperty::serialize(DataBuffer &buffer) {
 
 			//Value
 			{
-				IPropertyValue *value = new IPropertyValue();
-				std::string keyTypeStr = buffer.ctx<AssetCtx>().parsingSaveFormat ? valueType.str : valueType.getString(*buffer.ctx<AssetCtx>().header);
+				IPropertyValue *value = buffer.ctx<AssetCtx>().nodeArena().make<IPropertyValue>();
+				std::string_view keyTypeStr = buffer.ctx<AssetCtx>().parsingSaveFormat ? std::string_view(valueType.str) : valueType.getString(*buffer.ctx<AssetCtx>().header);
 				value->v = asset_helper::createPropertyValue(keyTypeStr);
 
 				buffer.ctx<AssetCtx>().parseHeader = false;
@@ -367,10 +353,10 @@ void MapProperty::serialize(DataBuffer &buffer) {
 }
 
 
-const std::string& StringRef32::getString(const AssetHeader &header) const {
+std::string_view StringRef32::getString(const AssetHeader &header) const {
 	return header.getHeaderRef(ref);
 }
 
-const std::string& StringRef64::getString(const AssetHeader &header) const {
+std::string_view StringRef64::getString(const AssetHeader &header) const {
 	return header.getHeaderRef(ref);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "core_types.h"
 #include "serialize.h"
+#include "arena.h"
+#include "parallel.h"
 #include "sha1.h"
 #include "crc.h"
 #include "hmx_midifile.h"
@@ -7,6 +9,8 @@
 #include <codecvt>
 #include <iostream>
 #include <cmath>
+#include <string_view>
+#include <filesystem>
 
 struct AssetHeader;
 
@@ -14,24 +18,240 @@ struct BaseCtx {
 	bool useStringRef = true;
 };
 
-struct UnrealName {
-	std::string name;
-	i16 nonCasePreservingHash;
-	i16 casePreservingHash;
+//A header's name table. The strings sit back to back in one pool, each null terminated so it can
+//be written straight out as an FString, and entries only say where theirs starts. Renaming appends
+//the new string to the pool; the old bytes stay until the table is next loaded.
+struct NameTable {
+	struct Entry {
+		u32 offset;
+		u32 length;
+		u16 nonCasePreservingHash;
+		u16 casePreservingHash;
+	};
 
-	void serialize(DataBuffer &buffer) {
-		buffer.serialize(name);
-		buffer.serialize(nonCasePreservingHash);
-		buffer.serialize(casePreservingHash);
+	NameTable() = default;
+	NameTable(NameTable&&) = default;
+	NameTable &operator=(NameTable&&) = default;
+	NameTable(const NameTable &other) : pool(other.pool), entries(other.entries), bytes(other.bytes) {
+		rebuildIndex();
+	}
+	NameTable &operator=(const NameTable &other) {
+		pool = other.pool;
+		entries = other.entries;
+		bytes = other.bytes;
+		rebuildIndex();
+		return *this;
+	}
+
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+
+	std::string_view operator[](size_t idx) const {
+		auto &&e = entries[idx];
+		return std::string_view(pool.data() + e.offset, e.length);
+	}
+
+	const char *c_str(size_t idx) const {
+		return pool.data() + entries[idx].offset;
+	}
+
+	Entry &entry(size_t idx) { return entries[idx]; }
+	const Entry &entry(size_t idx) const { return entries[idx]; }
+
+	//Index of the first name equal to str, -1 if there isn't one
+	i32 find(std::string_view str) const {
+		auto it = index.find(str);
+		return it != index.end() ? it->second : -1;
+	}
+
+	i32 add(std::string_view str) {
+		i32 idx = (i32)entries.size();
+		Entry e;
+		bool moved = append(str, e.offset);
+		str = std::string_view(pool.data() + e.offset, str.size());
+		if (moved) {
+			rebuildIndex();
+		}
+		e.length = (u32)str.size();
+		setHashes(e, str);
+		entries.emplace_back(e);
+		bytes += entrySize(str);
+
+		if (!index.try_emplace((*this)[idx], idx).second) {
+			hasDuplicates = true;
+		}
+		return idx;
+	}
+
+	void rename(size_t idx, std::string_view str) {
+		if ((*this)[idx] == str) {
+			return;
+		}
+
+		bytes += entrySize(str) - entrySize((*this)[idx]);
+
+		u32 offset;
+		bool moved = append(str, offset);
+		str = std::string_view(pool.data() + offset, str.size());
+		auto setEntry = [&]() {
+			auto &&e = entries[idx];
+			e.offset = offset;
+			e.length = (u32)str.size();
+			setHashes(e, str);
+		};
+
+		//The index's keys point into the pool
+		if (moved) {
+			setEntry();
+			rebuildIndex();
+			return;
+		}
+
+		auto it = index.find((*this)[idx]);
+		if (it != index.end() && (size_t)it->second == idx) {
+			index.erase(it);
+
+			//Headers can hold the same name more than once, the next copy takes over the old name
+			for (size_t i = idx + 1; hasDuplicates && i < entries.size(); ++i) {
+				if ((*this)[i] == (*this)[idx]) {
+					index.emplace((*this)[i], (i32)i);
+					break;
+				}
+			}
+		}
+
+		setEntry();
+		auto [slot, inserted] = index.try_emplace((*this)[idx], (i32)idx);
+		if (!inserted) {
+			hasDuplicates = true;
+			if (idx < (size_t)slot->second) {
+				slot->second = (i32)idx;
+			}
+		}
+	}
+
+	void rebuildIndex() {
+		index.clear();
+		index.reserve(entries.size());
+		hasDuplicates = false;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (!index.try_emplace((*this)[i], (i32)i).second) {
+				hasDuplicates = true;
+			}
+		}
+	}
+
+	void serialize(DataBuffer &buffer, i32 count) {
+		if (buffer.loading) {
+			//Every name takes at least its length and two hashes
+			if (count < 0) {
+				throw ParseError("names", "negative name count " + std::to_string(count));
+			}
+			buffer.require((size_t)count * 8, "names");
+
+			pool.clear();
+			entries.clear();
+			entries.reserve(count);
+			bytes = 0;
+
+			std::string str;
+			for (i32 i = 0; i < count; ++i) {
+				buffer.serialize(str);
+
+				Entry e;
+				e.offset = (u32)pool.size();
+				e.length = (u32)str.size();
+				pool.insert(pool.end(), str.begin(), str.end());
+				pool.push_back(0);
+
+				buffer.serialize(e.nonCasePreservingHash);
+				buffer.serialize(e.casePreservingHash);
+				entries.emplace_back(e);
+
+				//What it takes when written back, which isn't always what it took in the file
+				bytes += entrySize(str);
+			}
+
+			rebuildIndex();
+		}
+		else {
+			for (auto &&e : entries) {
+				buffer.writeString(pool.data() + e.offset, e.length, true);
+				buffer.serialize(e.nonCasePreservingHash);
+				buffer.serialize(e.casePreservingHash);
+			}
+		}
+	}
+
+	//Size of the table as serialize writes it
+	size_t serializedSize() const {
+		return bytes;
+	}
+
+	//The two hashes UE stores with every name: a case insensitive one and a CRC of the exact string
+	static void setHashes(Entry &e, std::string_view str) {
+		if (utf_convert::isAscii(str.data(), str.size())) {
+			e.nonCasePreservingHash = (u16)CRC::Strihash_DEPRECATED(str.data(), str.size());
+			e.casePreservingHash = (u16)CRC::StrCrc32(str.data(), str.size());
+			return;
+		}
+
+		//Hashed the way it's stored, as UTF-16
+		std::vector<u16> units;
+		const char *p = str.data();
+		const char *end = p + str.size();
+		while (p < end) {
+			u32 cp = utf_convert::readUtf8(p, end);
+			if (cp >= 0x10000) {
+				cp -= 0x10000;
+				units.emplace_back((u16)(0xD800 + (cp >> 10)));
+				units.emplace_back((u16)(0xDC00 + (cp & 0x3FF)));
+			}
+			else {
+				units.emplace_back((u16)cp);
+			}
+		}
+		e.nonCasePreservingHash = (u16)CRC::Strihash_DEPRECATED(units.data(), units.size());
+		e.casePreservingHash = (u16)CRC::StrCrc32(units.data(), units.size());
+	}
+
+	bool hasDuplicates = false;
+
+private:
+	static size_t entrySize(std::string_view str) {
+		return DataBuffer::stringSize(str.data(), str.size()) + sizeof(Entry::nonCasePreservingHash) + sizeof(Entry::casePreservingHash);
+	}
+
+	//Adds str and its terminator to the pool. Returns true if that moved the pool, which leaves
+	//the index, and str if it was a view of a pooled name, pointing at the old one.
+	bool append(std::string_view str, u32 &offset) {
+		size_t needed = pool.size() + str.size() + 1;
+		bool moves = needed > pool.capacity();
+		offset = (u32)pool.size();
+
+		if (moves) {
+			//str may be a view of a name already in the pool
+			std::string copy(str);
+			pool.reserve(std::max(needed, pool.capacity() * 2));
+			pool.insert(pool.end(), copy.begin(), copy.end());
+		}
+		else {
+			pool.insert(pool.end(), str.begin(), str.end());
+		}
+		pool.push_back(0);
+		return moves;
 	}
+
+	std::vector<char> pool;
+	std::vector<Entry> entries;
+	size_t bytes = 0;
+	std::unordered_map<std::string_view, i32> index;
 };
 
 struct Guid {
 	char guid[16];
 
-	void serialize(DataBuffer &buffer) {
-		buffer.serialize(guid);
-	}
+	using fields = FieldList<&Guid::guid>;
 };
 
 struct Link {
@@ -40,11 +260,14 @@ struct Link {
 	i32 link;
 	u64 property;
 
+	static const size_t SERIALIZED_SIZE = 28;
+
 	void serialize(DataBuffer &buffer) {
-		buffer.serialize(base);
-		buffer.serialize(cls);
-		buffer.serialize(link);
-		buffer.serialize(property);
+		auto r = buffer.region(SERIALIZED_SIZE, "Link");
+		r(base);
+		r(cls);
+		r(link);
+		r(property);
 	}
 };
 
@@ -62,8 +285,8 @@ struct StringRef32 {
 		}
 	}
 
-	const std::string& getString(const AssetHeader &header) const;
-	const std::string& getString(const AssetHeader *header) const {
+	std::string_view getString(const AssetHeader &header) const;
+	std::string_view getString(const AssetHeader *header) const {
 		if (header) {
 			return getString(*header);
 		}
@@ -89,8 +312,17 @@ struct StringRef64 {
 	StringRef64() {}
 	StringRef64(StringRef32 r) : ref(r.ref), str(r.str) {}
 
-	const std::string& getString(const AssetHeader &header) const;
-	const std::string& getString(const AssetHeader *header) const {
+	bool operator==(const StringRef64& rhs) {
+		if (str.empty()) {
+			return ref == rhs.ref;
+		}
+		else {
+			return str == rhs.str;
+		}
+	}
+
+	std::string_view getString(const AssetHeader &header) const;
+	std::string_view getString(const AssetHeader *header) const {
 		if (header) {
 			return getString(*header);
 		}
@@ -137,35 +369,38 @@ struct Catagory {
 	i32 serializationBeforeCreateDependencies;
 	i32 createBeforeCreateDependencies;
 
+	static const size_t SERIALIZED_SIZE = 104;
+
 	void serialize(DataBuffer &buffer) {
-		buffer.serialize(classIdx);
-		buffer.serialize(superIdx);
+		auto r = buffer.region(SERIALIZED_SIZE, "Catagory");
+		r(classIdx);
+		r(superIdx);
 		
-		buffer.serialize(templateIdx);
+		r(templateIdx);
 
-		buffer.serialize(outerIdx);
-		buffer.serialize(objectName);
+		r(outerIdx);
+		r(objectName);
 
-		buffer.serialize(objectFlags);
+		r(objectFlags);
 
-		buffer.watch([&]() { buffer.serialize(lengthV); });
-		buffer.watch([&]() { buffer.serialize(startV); });
+		r(lengthV);
+		r(startV);
 
-		buffer.serialize(forcedExport);
-		buffer.serialize(notForClient);
-		buffer.serialize(notForServer);
+		r(forcedExport);
+		r(notForClient);
+		r(notForServer);
 
-		buffer.serialize(packageGuid);
-		buffer.serialize(packageFlags);
+		r(packageGuid);
+		r(packageFlags);
 
-		buffer.serialize(notAlwaysLoadedForEditorGame);
-		buffer.serialize(isAsset);
+		r(notAlwaysLoadedForEditorGame);
+		r(isAsset);
 
-		buffer.serialize(firstExportDependency);
-		buffer.serialize(serializationBeforeSerializationDependencies);
-		buffer.serialize(createBeforeSerializationDependencies);
-		buffer.serialize(serializationBeforeCreateDependencies);
-		buffer.serialize(createBeforeCreateDependencies);
+		r(firstExportDependency);
+		r(serializationBeforeSerializationDependencies);
+		r(createBeforeSerializationDependencies);
+		r(serializationBeforeCreateDependencies);
+		r(createBeforeCreateDependencies);
 	}
 };
 
@@ -184,13 +419,7 @@ struct Version {
 	i32 changelist;
 	std::string branch;
 
-	void serialize(DataBuffer &buffer) {
-		buffer.serialize(major);
-		buffer.serialize(minor);
-		buffer.serialize(patch);
-		buffer.serialize(changelist);
-		buffer.serialize(branch);
-	}
+	using fields = FieldList<&Version::major, &Version::minor, &Version::patch, &Version::changelist, &Version::branch>;
 };
 
 struct CustomVersion {
@@ -233,9 +462,12 @@ struct AssetHeader {
 		i32 exportCount;
 		i32 nameCount;
 
+		static const size_t SERIALIZED_SIZE = 8;
+
 		void serialize(DataBuffer &buffer) {
-			buffer.serialize(exportCount);
-			buffer.serialize(nameCount);
+			auto r = buffer.region(SERIALIZED_SIZE, "Generation");
+			r(exportCount);
+			r(nameCount);
 		}
 	};
 	std::vector<Generation> generations;
@@ -265,7 +497,7 @@ struct AssetHeader {
 	i32 preloadDependencyCount;
 	i32 preloadDependencyOffset;
 
-	std::vector<UnrealName> names;
+	NameTable names;
 	std::vector<Link> links;
 	std::vector<Catagory> catagories;
 	std::vector<CatagoryRef> catagoryGroups;
@@ -275,7 +507,7 @@ struct AssetHeader {
 	std::vector<i32> preloadDependencies;
 
 	const Link& getLinkRef(i32 idx) const {
-		if (idx < 0) {
+		if (idx < 0 && (size_t)-(idx + 1) < links.size()) {
 			return links[-(idx + 1)];
 		}
 		else {
@@ -284,61 +516,55 @@ struct AssetHeader {
 		}
 	}
 
-	const std::string& getHeaderRef(i32 ref) const {
-		static std::string BAD_STRING = "BAD";
-		if (ref < 0) return BAD_STRING;
-		if (ref > names.size()) BAD_STRING;
-		return names[ref].name;
+	std::string_view getHeaderRef(i32 ref) const {
+		if (ref < 0) return "BAD";
+		if ((size_t)ref >= names.size()) return "BAD";
+		return names[ref];
 	}
 
-	StringRef32 findOrCreateName(const std::string &str) {
-		for (size_t i = 0; i < names.size(); ++i) {
-			if (names[i].name == str) {
-				StringRef32 r;
-				r.ref = i;
-				return r;
-			}
-		}
+	//Names should only be added through findOrCreateName and changed through renameName. This is
+	//bumped whenever an existing name changes, so indices built on top of names know to rebuild.
+	u32 nameGeneration = 0;
 
-		auto idx = names.size();
-		UnrealName name;
-		name.name = str;
-		names.emplace_back(name);
+	void rebuildNameIndex() {
+		++nameGeneration;
+		names.rebuildIndex();
+	}
 
+	StringRef32 findOrCreateName(std::string_view str) {
 		StringRef32 r;
-		r.ref = idx;
+		r.ref = names.find(str);
+		if (r.ref == -1) {
+			r.ref = names.add(str);
+		}
 		return r;
 	}
 
-	StringRef32 findName(const std::string &str) {
-		for (size_t i = 0; i < names.size(); ++i) {
-			if (names[i].name == str) {
-				StringRef32 r;
-				r.ref = i;
-				return r;
-			}
-		}
-
+	StringRef32 findName(std::string_view str) const {
 		StringRef32 r;
-		r.ref = std::numeric_limits<i32>::max();
+		r.ref = names.find(str);
+		if (r.ref == -1) {
+			r.ref = std::numeric_limits<i32>::max();
+		}
 		return r;
 	}
 
-	void serialize(DataBuffer &buffer) {
-		if (!buffer.loading) {
-			nameCount = names.size();
-
-			if (generations.size() > 0) {
-				generations[0].exportCount = exportsCount;
-				generations[0].nameCount = nameCount;
-			}
+	void renameName(size_t idx, std::string_view str) {
+		if (names[idx] == str) {
+			return;
 		}
 
-		size_t start = 0;
+		++nameGeneration;
+		names.rename(idx, str);
+	}
 
+	//The fixed part at the start of the header, up to where the sections begin
+	void serializeSummary(DataBuffer &buffer) {
 		buffer.serialize(magic);
 		if (magic != 0x9E2A83C1) {
-			__debugbreak();
+			if (buffer.loading) {
+				throw ParseError("AssetHeader", "bad magic");
+			}
 			return;
 		}
 
@@ -347,24 +573,24 @@ struct AssetHeader {
 		buffer.serialize(UE4FileVersion);
 		buffer.serialize(fileVersionLincenceeUE4);
 		buffer.serialize(customVersions);
-		buffer.watch([&]() { buffer.serialize(totalHeaderSize); });
+		buffer.serialize(totalHeaderSize);
 		buffer.serialize(name);
 		buffer.serialize(packageFlags);
 		buffer.serialize(nameCount);
-		buffer.watch([&]() { buffer.serialize(nameOffset); });
+		buffer.serialize(nameOffset);
 		buffer.serialize(localizationId);
 		buffer.serialize(gatherableTextDataCount);
 		
 		buffer.serialize(exportsCount);
-		buffer.watch([&]() { buffer.serialize(exportsOffset); });
+		buffer.serialize(exportsOffset);
 
 		buffer.serialize(importCount);
-		buffer.watch([&]() { buffer.serialize(importOffset); });
+		buffer.serialize(importOffset);
 		
-		buffer.watch([&]() { buffer.serialize(dependenciesOffset); });
+		buffer.serialize(dependenciesOffset);
 
 		buffer.serialize(softPackageReferencesCount);
-		buffer.watch([&]() { buffer.serialize(softPackageReferencesOffset); });
+		buffer.serialize(softPackageReferencesOffset);
 
 		buffer.serialize(searchableNamesOffset);
 		buffer.serialize(thumbnailTableOffset);
@@ -381,49 +607,123 @@ struct AssetHeader {
 		buffer.serialize(packageSource);
 		buffer.serialize(additionalPackagesToCook);
 
-		buffer.watch([&]() { buffer.serialize(assetRegistryDataOffset); });
-		buffer.watch([&]() { buffer.serialize(bulkDataStartOffset); });
+		buffer.serialize(assetRegistryDataOffset);
+		//Set by the exports, which a pak sizes before their header
+		buffer.serialize(bulkDataStartOffset);
 
 		buffer.serialize(worldTileInfoDataOffset);
 		buffer.serialize(chunkIDs);
 		buffer.serialize(preloadDependencyCount);
-		buffer.watch([&]() { buffer.serialize(preloadDependencyOffset); });
+		buffer.serialize(preloadDependencyOffset);
+	}
+
+	//Whether the asset registry data and preload dependencies follow the other sections
+	bool hasRegistrySections() const {
+		return totalHeaderSize > 0 && exportsCount > 0;
+	}
+
+	//Works out the offset of every section and the total size from what's in memory, so the
+	//summary can be written with its final values and everything after it straight through.
+	void planLayout(bool withRegistry) {
+		DataBuffer counter;
+		counter.setupCounting();
+		serializeSummary(counter);
+
+		i32 pos = (i32)counter.size;
+
+		nameOffset = pos;
+		pos += (i32)names.serializedSize();
+
+		importOffset = pos;
+		pos += importCount * (i32)Link::SERIALIZED_SIZE;
+
+		exportsOffset = pos;
+		pos += exportsCount * (i32)Catagory::SERIALIZED_SIZE;
+
+		dependenciesOffset = pos;
+		for (i32 i = 0; i < exportsCount; ++i) {
+			pos += (i32)(sizeof(i32) + catagoryGroups[i].data.size() * sizeof(i32));
+		}
+
+		if (softPackageReferencesOffset != 0) {
+			softPackageReferencesOffset = pos;
+			for (i32 i = 0; i < softPackageReferencesCount; ++i) {
+				pos += (i32)DataBuffer::stringSize(section5Strings[i].data(), section5Strings[i].size());
+			}
+		}
+
+		if (withRegistry) {
+			assetRegistryDataOffset = pos;
+			pos += (i32)(sizeof(i32) + uexpData.size() * sizeof(i32));
+
+			preloadDependencyOffset = pos;
+			pos += preloadDependencyCount * (i32)sizeof(i32);
+		}
+
+		totalHeaderSize = pos;
+	}
+
+	void serialize(DataBuffer &buffer) {
+		bool withRegistry = hasRegistrySections();
 
-		auto jumpOrSetOffset = [&buffer](auto &pos) {
+		if (!buffer.loading) {
+			nameCount = names.size();
+
+			if (generations.size() > 0) {
+				generations[0].exportCount = exportsCount;
+				generations[0].nameCount = nameCount;
+			}
+
+			planLayout(withRegistry);
+		}
+
+		size_t start = buffer.pos;
+		serializeSummary(buffer);
+		if (magic != 0x9E2A83C1) {
+			return;
+		}
+
+		//Loading follows the offsets, saving checks it's where the plan put each section
+		auto section = [&](i32 offset) {
 			if (buffer.loading) {
-				buffer.pos = pos;
+				buffer.pos = start + offset;
 			}
-			else {
-				pos = buffer.pos;
+			else if (buffer.pos != start + offset) {
+				__debugbreak();
 			}
 		};
 
-		jumpOrSetOffset(nameOffset);
-		buffer.serializeWithSize(names, nameCount);
+		section(nameOffset);
+		names.serialize(buffer, nameCount);
+		if (buffer.loading) {
+			++nameGeneration;
+		}
 
-		jumpOrSetOffset(importOffset);
+		section(importOffset);
 		buffer.serializeWithSize(links, importCount);
 
-		jumpOrSetOffset(exportsOffset);
+		section(exportsOffset);
 		buffer.serializeWithSize(catagories, exportsCount);
 
-		jumpOrSetOffset(dependenciesOffset);
+		section(dependenciesOffset);
 		buffer.serializeWithSize(catagoryGroups, exportsCount);
 
 		if (softPackageReferencesOffset != 0) {
-			jumpOrSetOffset(softPackageReferencesOffset);
+			section(softPackageReferencesOffset);
 			buffer.serializeWithSize(section5Strings, softPackageReferencesCount);
 		}
 
-		if (totalHeaderSize > 0 && exportsCount > 0) {
-			jumpOrSetOffset(assetRegistryDataOffset);
+		if (buffer.loading ? hasRegistrySections() : withRegistry) {
+			section(assetRegistryDataOffset);
 			buffer.serialize(uexpData);
 
-			jumpOrSetOffset(preloadDependencyOffset);
+			section(preloadDependencyOffset);
 			buffer.serializeWithSize(preloadDependencies, preloadDependencyCount);
 		}
 
-		if (!buffer.loading) totalHeaderSize = buffer.pos;
+		if (!buffer.loading) {
+			section(totalHeaderSize);
+		}
 	}
 };
 
@@ -432,6 +732,19 @@ struct AssetHeader {
 struct AssetCtx {
 	BaseCtx baseCtx;
 	AssetHeader *header = nullptr;
+	//Property nodes parsed out of the asset are allocated from here
+	Arena *arena = nullptr;
+
+	//The arena, when loading nodes. Whatever owns the nodes has to set one: there's nowhere else
+	//to put them that lives as long as they do.
+	Arena &nodeArena() {
+		if (!arena) {
+			__debugbreak();
+		}
+		return *arena;
+	}
+	//Keep exports as raw bytes until something asks for them, see AssetData::CatagoryValue
+	bool lazyExports = false;
 	i64 length = 0;
 	bool parseHeader = true;
 	u32 headerSize = 0;
@@ -536,24 +849,10 @@ struct NameProperty {
 struct IPropertyValue;
 
 struct ArrayProperty {
-	ArrayProperty() {}
-	ArrayProperty(ArrayProperty &&rhs) {
-		arrayType = std::move(rhs.arrayType);
-		values = std::move(rhs.values);
-		rhs.values.clear();
-	}
-	ArrayProperty& operator=(ArrayProperty&& rhs) {
-		arrayType = std::move(rhs.arrayType);
-		values = std::move(rhs.values);
-		rhs.values.clear();
-		return *this;
-	}
-
 	static const bool custom_header = true;
 	StringRef64 arrayType;
 	std::vector<IPropertyValue*> values;
 
-	~ArrayProperty();
 	void serialize(DataBuffer &buffer);
 };
 
@@ -659,7 +958,7 @@ struct IPropertyDataList;
 struct UnknownProperty {
 	static const bool needs_length = true;
 
-	std::vector<u8> data;
+	MappedBytes data;
 
 	void serialize(DataBuffer &buffer) {
 		buffer.serializeWithSize(data, (size_t)buffer.ctx<AssetCtx>().length);
@@ -670,7 +969,9 @@ namespace asset_helper {
 	using PropertyValue = std::variant<UnknownProperty, BoolProperty, PrimitiveProperty<i8>, PrimitiveProperty<i16>, PrimitiveProperty<i32>, PrimitiveProperty<i64>, PrimitiveProperty<u16>, PrimitiveProperty<u32>, PrimitiveProperty<u64>, PrimitiveProperty<float>,
 									   TextProperty, StringProperty, ObjectProperty, EnumProperty, ByteProperty, NameProperty, ArrayProperty, MapProperty, StructProperty, PrimitiveProperty<Guid>, SoftObjectProperty, IPropertyDataList*, DateTime>;
 
-	PropertyValue createPropertyValue(const std::string &type, const bool useUnknown = true);
+	//Unknown types come back as UnknownProperty, or as a nested property list allocated from
+	//structArena when parsing struct members
+	PropertyValue createPropertyValue(std::string_view type, Arena *structArena = nullptr);
 	std::string getTypeForValue(const PropertyValue &v);
 
 	void serialize(DataBuffer &buffer, i64 length, PropertyValue &value);
@@ -718,7 +1019,7 @@ struct PropertyData {
 
 
 		if (buffer.loading) {
-			std::string type;
+			std::string_view type;
 
 			if (!buffer.ctx<AssetCtx>().parsingSaveFormat) {
 				type = nameRef.getString(*headerPtr);
@@ -739,13 +1040,17 @@ struct PropertyData {
 		buffer.ctx<AssetCtx>().headerSize = 0;
 		asset_helper::serialize(buffer, length, value);
 
+		//Only goes back over the length if it changed. A pak counts every entry before writing
+		//it, so by then the length is already right and nothing behind the data is rewritten.
 		if (!buffer.loading && asset_helper::needsLength(value)) {
 			size_t finalPos = buffer.pos;
-			length = (finalPos - beforeProp) - buffer.ctx<AssetCtx>().headerSize;
-			buffer.pos = beforeProp - sizeof(length);
-			buffer.serialize(length);
-			buffer.pos = finalPos;
-
+			i64 written = (finalPos - beforeProp) - buffer.ctx<AssetCtx>().headerSize;
+			if (written != length) {
+				length = written;
+				buffer.pos = beforeProp - sizeof(length);
+				buffer.serialize(length);
+				buffer.pos = finalPos;
+			}
 		}
 
 		buffer.ctx<AssetCtx>().headerSize = prevSize;
@@ -766,13 +1071,54 @@ struct IPropertyDataList {
 	}
 
 	PropertyData* get(AssetHeader *header, const std::string &name) {
-		for (auto &&p : properties) {
-			if (p.nameRef.getString(header) == name) {
-				return &p;
+		if (!header) {
+			for (auto &&p : properties) {
+				if (p.nameRef.str == name) {
+					return &p;
+				}
 			}
+			return nullptr;
 		}
 
-		return nullptr;
+		auto ref = header->findName(name);
+		if (ref.ref == std::numeric_limits<i32>::max()) {
+			return nullptr;
+		}
+
+		if (!refIndexValid || indexedHeader != header || indexedGeneration != header->nameGeneration || indexedCount != properties.size()) {
+			rebuildIndex(header);
+		}
+
+		auto p = findIndexed(ref.ref);
+		//A hit under another name means a nameRef was edited in place since the index was built
+		if (p && p->nameRef.getString(header) != name) {
+			rebuildIndex(header);
+			p = findIndexed(ref.ref);
+		}
+
+		//So can a miss, if the edit gave a property this name. Making sure costs a linear search,
+		//what every lookup used to cost, and only misses pay it.
+		if (!p) {
+			for (auto &&prop : properties) {
+				auto &&nameRef = prop.nameRef;
+				if (nameRef.ref >= 0 && (size_t)nameRef.ref < header->names.size() && header->names[nameRef.ref] == name) {
+					rebuildIndex(header);
+					return &prop;
+				}
+			}
+		}
+		return p;
+	}
+
+	PropertyData& add(PropertyData &&prop) {
+		properties.emplace_back(std::move(prop));
+		refIndexValid = false;
+		return properties.back();
+	}
+
+	//Needed after changing properties directly instead of through add()
+	void invalidateIndex() {
+		refIndexValid = false;
 	}
 
 	void serialize(DataBuffer &buffer) {
@@ -807,6 +1153,44 @@ struct IPropertyDataList {
 
 		buffer.ctx<AssetCtx>().parseHeader = parseHeader;
 	}
+
+private:
+	//(name ref, property index) sorted by name ref. Refs are the header's first occurrence of the
+	//name, so duplicate names in the header still find the property.
+	std::vector<std::pair<i32, u32>> refIndex;
+	bool refIndexValid = false;
+	const AssetHeader *indexedHeader = nullptr;
+	u32 indexedGeneration = 0;
+	size_t indexedCount = 0;
+
+	void rebuildIndex(AssetHeader *header) {
+		refIndex.clear();
+		refIndex.reserve(properties.size());
+		for (u32 i = 0; i < properties.size(); ++i) {
+			auto &&nameRef = properties[i].nameRef;
+			if (nameRef.ref < 0 || (size_t)nameRef.ref >= header->names.size()) {
+				continue;
+			}
+			refIndex.emplace_back(header->findName(header->names[nameRef.ref]).ref, i);
+		}
+
+		//The first property with a name wins, same as a linear search
+		std::stable_sort(refIndex.begin(), refIndex.end(), [](auto &&a, auto &&b) { return a.first < b.first; });
+		refIndex.erase(std::unique(refIndex.begin(), refIndex.end(), [](auto &&a, auto &&b) { return a.first == b.first; }), refIndex.end());
+
+		refIndexValid = true;
+		indexedHeader = header;
+		indexedGeneration = header->nameGeneration;
+		indexedCount = properties.size();
+	}
+
+	PropertyData* findIndexed(i32 ref) {
+		auto it = std::lower_bound(refIndex.begin(), refIndex.end(), ref, [](auto &&a, i32 r) { return a.first < r; });
+		if (it == refIndex.end() || it->first != ref) {
+			return nullptr;
+		}
+		return &properties[it->second];
+	}
 };
 
 struct UObject {
@@ -896,16 +1280,9 @@ struct HmxAudio {
 			u32 maybe_channels2;
 			u32 moggSize;
 
-			void serialize(DataBuffer &buffer) {
-				buffer.serialize(identifier);
-				buffer.serialize(unk1_samples);
-				buffer.serialize(sample_rate);
-				buffer.serialize(maybe_channels);
-				buffer.serialize(numberOfSamples);
-				buffer.serialize(unk2);
-				buffer.serialize(maybe_channels2);
-				buffer.serialize(moggSize);
-			}
+			using fields = FieldList<&MoggSampleResourceHeader::identifier, &MoggSampleResourceHeader::unk1_samples, &MoggSampleResourceHeader::sample_rate,
+				&MoggSampleResourceHeader::maybe_channels, &MoggSampleResourceHeader::numberOfSamples, &MoggSampleResourceHeader::unk2,
+				&MoggSampleResourceHeader::maybe_channels2, &MoggSampleResourceHeader::moggSize>;
 		};
 
 		struct MidiMusicResource {
@@ -1114,11 +1491,7 @@ struct HmxAudio {
 				u32 start_tick;
 				u32 tempo;
 
-				void serialize(DataBuffer& buffer) {
-					buffer.serialize(start_ms);
-					buffer.serialize(start_tick);
-					buffer.serialize(tempo);
-				}
+				using fields = FieldList<&Tempo::start_ms, &Tempo::start_tick, &Tempo::tempo>;
 			};
 
 			std::vector<Tempo> tempos;
@@ -1130,12 +1503,8 @@ struct HmxAudio {
 				u32 tick;
 				i16 numerator;
 				i16 denominator;
-				void serialize(DataBuffer& buffer) {
-					buffer.serialize(measure);
-					buffer.serialize(tick);
-					buffer.serialize(numerator);
-					buffer.serialize(denominator);
-				}
+
+				using fields = FieldList<&TimeSig::measure, &TimeSig::tick, &TimeSig::numerator, &TimeSig::denominator>;
 			};
 
 			std::vector<TimeSig> timesigs;
@@ -1144,10 +1513,9 @@ struct HmxAudio {
 			struct Beat {
 				u32 tick;
 				bool downbeat;
-				void serialize(DataBuffer& buffer) {
-					buffer.serialize(tick);
-					buffer.serialize(downbeat);
-				}
+
+				//Padded in memory, so this one still goes field by field
+				using fields = FieldList<&Beat::tick, &Beat::downbeat>;
 			};
 
 			std::vector<Beat> beats;
@@ -1366,7 +1734,8 @@ struct HmxAudio {
 			}
 			
 			void MFR_from_midi(std::string file) {
-				MidiFile inMidi = MidiFile::ReadMidi (std::ifstream(file, std::ios_base::binary));
+				std::ifstream midiStream(file, std::ios_base::binary);
+				MidiFile inMidi = MidiFile::ReadMidi(midiStream);
 				magic = 2;
 				if (inMidi.ticks_per_qn() != 480) {
 					magic = 480;
@@ -1612,7 +1981,7 @@ struct HmxAudio {
 		};
 
 		std::variant<std::monostate, MoggSampleResourceHeader, MidiMusicResource, FusionFileResource, MidiFileResource> resourceHeader;
-		std::vector<u8> fileData;
+		MappedBytes fileData;
 
 
 		void serialize(DataBuffer &buffer) {
@@ -1620,7 +1989,10 @@ struct HmxAudio {
 			buffer.serialize(fileName);
 			buffer.serialize(null);
 			buffer.serialize(fileType);
-			buffer.watch([&]() { buffer.serialize(totalSize); });
+			if (!buffer.loading) {
+				planSave(buffer);
+			}
+			buffer.serialize(totalSize);
 
 			if (buffer.loading) {
 				if (fileType == "MoggSampleResource") {
@@ -1637,7 +2009,7 @@ struct HmxAudio {
 				else if (fileType == "FusionPatchResource") {
 					FusionFileResource resource;
 					buffer.serializeWithSize(fileData, totalSize);
-					resource.nodes = hmx_fusion_parser::parseData(fileData);
+					resource.nodes = hmx_fusion_parser::parseData(fileData.owned());
 					resourceHeader = std::move(resource);
 				}
 				else if (fileType == "MidiFileResource") {
@@ -1650,31 +2022,37 @@ struct HmxAudio {
 				}
 			}
 			else {
-				u32 start = buffer.pos;
+				serializeResource(buffer);
+				buffer.serializeWithSize(fileData, fileData.size());
+			}
+		}
 
-				if (auto moggHeader = std::get_if<MoggSampleResourceHeader>(&resourceHeader)) {
-					moggHeader->moggSize = fileData.size();
+		void serializeResource(DataBuffer &buffer) {
+			std::visit([&](auto &&value) {
+				using T = std::decay_t<decltype(value)>;
+				if constexpr (!std::is_same_v<T, std::monostate>) {
+					buffer.serialize(value);
 				}
+			}, resourceHeader);
+		}
 
-				std::visit([&](auto &&value) {
-					using T = std::decay_t<decltype(value)>;
-					if constexpr (!std::is_same_v<T, std::monostate>) {
-						buffer.serialize(value);
-					}
-				}, resourceHeader);
-
-				if (auto fusionResource = std::get_if<FusionFileResource>(&resourceHeader)) {
-					auto str = hmx_fusion_parser::outputData(fusionResource->nodes);
-
-					fileData.clear();
-					fileData.resize(str.size());
-					std::memcpy(fileData.data(), str.data(), fileData.size());
-				}
+		//Brings the data and everything about it up to date, so totalSize can go out ahead of them
+		void planSave(DataBuffer &buffer) {
+			if (auto fusionResource = std::get_if<FusionFileResource>(&resourceHeader)) {
+				auto str = hmx_fusion_parser::outputData(fusionResource->nodes);
 
-				buffer.serializeWithSize(fileData, fileData.size());
+				fileData = std::vector<u8>(str.begin(), str.end());
+			}
 
-				totalSize = buffer.pos - start;
+			if (auto moggHeader = std::get_if<MoggSampleResourceHeader>(&resourceHeader)) {
+				moggHeader->moggSize = fileData.size();
 			}
+
+			DataBuffer counter;
+			counter.setupCounting();
+			counter.ctx_ = buffer.ctx_;
+			serializeResource(counter);
+			totalSize = counter.size + fileData.size();
 		}
 	};
 
@@ -1696,15 +2074,20 @@ struct Mip {
 	uint32_t len_1;
 	uint32_t len_2;
 	uint64_t offset;
-	std::vector<u8> mipData;
+	MappedBytes mipData;
 	uint32_t width;
 	uint32_t height;
+
+	//Everything before mipData
+	static const size_t HEADER_SIZE = 28;
+
 	void serialize(DataBuffer& buffer) {
-		buffer.serialize(entry_identifier);
-		buffer.serialize(flags);
-		buffer.serialize(len_1);
-		buffer.serialize(len_2);
-		buffer.serialize(offset);
+		auto r = buffer.region(HEADER_SIZE, "Mip");
+		r(entry_identifier);
+		r(flags);
+		r(len_1);
+		r(len_2);
+		r(offset);
 		buffer.serializeWithSize(mipData, len_1);
 		buffer.serialize(width);
 		buffer.serialize(height);
@@ -1833,8 +2216,75 @@ struct AssetData {
 	struct CatagoryValue {
 		using CatagoryVariant = std::variant<UObject, DataTableCategory, HmxAssetFile, Texture2D>;
 
-		CatagoryVariant value;
+		CatagoryVariant parsed;
 		std::vector<u8> extraData;
+
+		//An export that hasn't been looked at yet, kept as the bytes it was loaded from. Saving
+		//writes these straight back out, so exports nothing touches never get parsed at all.
+		struct Unparsed {
+			MappedBytes bytes;
+			std::string className;
+			i64 length;
+			AssetHeader *header;
+			Arena *arena;
+		};
+		std::optional<Unparsed> unparsed;
+
+		//Parses the export on first access, from then on it gets saved from the parsed value
+		CatagoryVariant &value() {
+			if (unparsed) {
+				parse();
+			}
+			return parsed;
+		}
+
+		static void parseExport(DataBuffer &b, const std::string &className, i64 end, CatagoryValue &v) {
+			if (className == "DataTable") {
+				DataTableCategory dataCat;
+				b.serialize(dataCat);
+				v.parsed = std::move(dataCat);
+			}
+			else if (className == "HmxMidiSongAsset" || className == "HmxMidiFileAsset" || className == "HmxFusionAsset") {
+				HmxAssetFile asset;
+				b.serialize(asset);
+				v.parsed = std::move(asset);
+			}
+			else if (className == "Texture2D") {
+				Texture2D texture;
+				b.serialize(texture);
+				v.parsed = std::move(texture);
+			}
+			else {
+				UObject object;
+				b.serialize(object);
+				v.parsed = std::move(object);
+			}
+
+			i32 extraLen = end - b.pos;
+			b.serializeWithSize(v.extraData, extraLen);
+		}
+
+	private:
+		void parse() {
+			auto &&u = *unparsed;
+
+			AssetCtx ctx;
+			ctx.header = u.header;
+			ctx.arena = u.arena;
+
+			DataBuffer b;
+			b.setupMemory(u.bytes.data(), std::min<size_t>(u.length, u.bytes.size()), u.bytes.file());
+			b.ctx_ = &ctx;
+
+			try {
+				parseExport(b, u.className, u.bytes.size(), *this);
+			}
+			catch (const ParseError &e) {
+				throw e.within("export (" + u.className + ")");
+			}
+
+			unparsed.reset();
+		}
 	};
 	std::vector<CatagoryValue> catagoryValues;
 	i32 footer;
@@ -1845,45 +2295,36 @@ struct AssetData {
 		if (buffer.loading) {
 			size_t catIdx = 0;
 			for(auto &&c : header.catagories) {
-				DataBuffer b = buffer.setupFromHere();
-				b.size = c.lengthV;
-
 				CatagoryValue v;
 
-				std::string name = header.getHeaderRef(header.getLinkRef(c.classIdx).property);
-				if (name == "DataTable") {
-					DataTableCategory dataCat;
-					b.serialize(dataCat);
-					v.value = std::move(dataCat);
-				}
-				else if (name == "HmxMidiSongAsset" || name == "HmxMidiFileAsset" || name == "HmxFusionAsset") {
-					HmxAssetFile asset;
-					b.serialize(asset);
-					v.value = std::move(asset);
-				}
-				else if (name == "Texture2D") {
-					Texture2D texture;
-					b.serialize(texture);
-					v.value = std::move(texture);
-				}
-				else {
-					UObject object;
-					b.serialize(object);
-					v.value = std::move(object);
-				}
-
 				i32 nextStart = buffer.size - buffer.pos - 4;
 				if (catIdx + 1 < header.catagories.size()) {
 					nextStart = header.catagories[catIdx + 1].startV;
 				}
 
-				i32 extraLen = nextStart - b.pos;
-				b.serializeWithSize(v.extraData, extraLen);
+				std::string name(header.getHeaderRef(header.getLinkRef(c.classIdx).property));
+				try {
+					if (buffer.ctx<AssetCtx>().lazyExports) {
+						v.unparsed.emplace();
+						buffer.serializeWithSize(v.unparsed->bytes, nextStart);
+						v.unparsed->className = std::move(name);
+						v.unparsed->length = c.lengthV;
+						v.unparsed->header = &header;
+						v.unparsed->arena = buffer.ctx<AssetCtx>().arena;
+					}
+					else {
+						DataBuffer b = buffer.setupFromHere();
+						b.size = c.lengthV;
+						CatagoryValue::parseExport(b, name, nextStart, v);
+						buffer.skipPast(b);
+					}
+				}
+				catch (const ParseError &e) {
+					throw e.within("export " + std::to_string(catIdx) + " (" + name + ")");
+				}
 
 				catagoryValues.emplace_back(std::move(v));
 				++catIdx;
-
-				buffer.pos = b.pos + b.derivedBuffer->offset;
 			}
 		}
 		else {
@@ -1893,16 +2334,21 @@ struct AssetData {
 				size_t start = buffer.pos;
 
 				DataBuffer b = buffer.setupFromHere();
-				std::visit([&](auto &&v) {
-					b.serialize(v);
-				}, c.value);
+				if (c.unparsed) {
+					b.serializeWithSize(c.unparsed->bytes, c.unparsed->bytes.size());
+				}
+				else {
+					std::visit([&](auto &&v) {
+						b.serialize(v);
+					}, c.parsed);
 
-				b.serializeWithSize(c.extraData, c.extraData.size());
+					b.serializeWithSize(c.extraData, c.extraData.size());
+				}
 
 				header.catagories[idx].startV = start;
 				header.catagories[idx].lengthV = b.size;
 
-				buffer.pos = b.pos + b.derivedBuffer->offset;
+				buffer.skipPast(b);
 				++idx;
 			}
 		}
@@ -1913,8 +2359,8 @@ struct AssetData {
 		//
 
 		buffer.serialize(footer);
-		if (footer != 0x9E2A83C1) {
-			__debugbreak();
+		if (footer != 0x9E2A83C1 && buffer.loading) {
+			throw ParseError("AssetData", "bad footer magic");
 		}
 	}
 };
@@ -1922,11 +2368,13 @@ struct AssetData {
 struct Asset {
 	AssetHeader header;
 	AssetData data;
+	std::shared_ptr<Arena> arena = std::make_shared<Arena>();
 
 	void serialize(DataBuffer &buffer) {
 		AssetCtx ctx;
 		ctx.parseHeader = true;
 		ctx.header = &header;
+		ctx.arena = arena.get();
 		buffer.ctx_ = &ctx;
 
 		buffer.serialize(header);
@@ -1941,11 +2389,13 @@ struct SaveFile {
 	char start[48];
 	std::string structName;
 	IPropertyDataList properties;
+	std::shared_ptr<Arena> arena = std::make_shared<Arena>();
 
 	void serialize(DataBuffer &buffer) {
 		AssetCtx ctx;
 		ctx.baseCtx.useStringRef = false;
 		ctx.parsingSaveFormat = true;
+		ctx.arena = arena.get();
 
 		buffer.ctx_ = &ctx;
 		buffer.serialize(start);
@@ -1958,39 +2408,9 @@ struct SaveFile {
 struct SHAHash {
 	u8 data[20];
 	void serialize(DataBuffer &buffer) {
-		buffer.watch([&]() { buffer.serialize(data); });
-	}
-};
-
-
-struct FinalizeHash { 
-	size_t start;
-	size_t size;
-	SHAHash *hash;
-
-	void operator()(DataBuffer &b) {
-		SHA1 computedHash;
-		computedHash.reset();
-		computedHash.update(b.buffer + start, size);
-		computedHash.finalize();
-
-		memcpy(hash->data, computedHash.digest, sizeof(computedHash.digest));
-
-		auto&& myData = hash->data;
-		bool found = false;
-		for (auto &&w : b.watchedValues) {
-			if (w.data == (u8*)myData) {
-				memcpy(b.buffer + w.buffer_pos, myData, sizeof(myData));
-				found = true;
-			}
-		}
-
-		if (!found) {
-			__debugbreak();
-		}
+		buffer.serialize(data);
 	}
 };
-//
 
 enum class EPakVersion : u32
 {
@@ -2037,13 +2457,16 @@ struct PakFile {
 			buffer.serialize(isEncrypted);
 			buffer.serialize(magic);
 			if (magic != 0x5A6F12E1) {
+				if (buffer.loading) {
+					throw ParseError("Pak footer", "bad magic, not a pak file");
+				}
 				return;
 			}
 
 			buffer.serialize(version);
-			buffer.watch([&]() { buffer.serialize(indexOffset); });
-			buffer.watch([&]() { buffer.serialize(indexSize); });
-			buffer.watch([&]() { buffer.serialize(hash); });
+			buffer.serialize(indexOffset);
+			buffer.serialize(indexSize);
+			buffer.serialize(hash);
 
 			if (version == EPakVersion::FROZEN_INDEX) {
 				buffer.serialize(isFrozen);
@@ -2077,24 +2500,29 @@ struct PakFile {
 			bool inFilePrefix = false;
 			//
 
+			static const size_t SERIALIZED_SIZE = 53;
+			//Where hash is in the record, after offset, size, uncompressedSize and compressionMethodIdx
+			static const size_t HASH_OFFSET = 28;
+
 			void serialize(DataBuffer &buffer) {
+				auto r = buffer.region(SERIALIZED_SIZE, "EntryData");
 				if (inFilePrefix) {
 					i64 null = 0;
-					buffer.serialize(null);
+					r(null);
 				}
 				else {
-					buffer.watch([&]() { buffer.serialize(offset); });
+					r(offset);
 				}
 
-				buffer.watch([&]() { buffer.serialize(size); });
-				buffer.watch([&]() { buffer.serialize(uncompressedSize); });
-				buffer.serialize(compressionMethodIdx);
-				buffer.watch([&]() { buffer.serialize(hash); });
+				r(size);
+				r(uncompressedSize);
+				r(compressionMethodIdx);
+				r(hash);
 				if (compressionMethodIdx != 0) {
 
 				}
-				buffer.serialize(flags);
-				buffer.serialize(compressionBlockSize);
+				r(flags);
+				r(compressionBlockSize);
 			}
 		};
 		EntryData entryData;
@@ -2103,17 +2531,26 @@ struct PakFile {
 			PakEntry *pakHeader;
 			AssetData data;
 			size_t size;
+			//Owns every property node in data, copies of the entry share it
+			std::shared_ptr<Arena> arena = std::make_shared<Arena>();
 
 			void serialize(DataBuffer &buffer) {
 				auto header = &std::get<AssetHeader>(pakHeader->data);
 
 				AssetCtx ctx;
 				ctx.header = header;
+				ctx.arena = arena.get();
+				ctx.lazyExports = true;
 				buffer.ctx_ = &ctx;
 				buffer.serialize(data);
 
 				size = buffer.size;
 
+				//Saved before the header, so its size comes from what's in memory rather than its last save
+				if (!buffer.loading) {
+					header->planLayout(header->hasRegistrySections());
+				}
+
 				for (auto &&c : header->catagories) {
 					c.startV += header->totalHeaderSize;
 				}
@@ -2134,6 +2571,33 @@ struct PakFile {
 		PakAssetData &getData() {
 			return std::get<PakAssetData>(data);
 		}
+
+		//Set when anything that feeds this entry's bytes may have changed since they were last
+		//written. Clean entries are copied straight out of their saved bytes instead of being
+		//serialized again.
+		bool dirty = true;
+
+		//The entry's bytes as a view into the mapped pak they were loaded from or last saved to.
+		//Nothing else is kept: an entry that was serialized into anything but a file it can map
+		//again has no saved bytes, and is serialized on every save.
+		struct SavedBytes {
+			MappedBytes bytes;
+			SHAHash hash;
+		};
+		std::optional<SavedBytes> saved;
+
+		bool needsSerializing() const {
+			return dirty || !saved;
+		}
+
+		//A .uexp and its .uasset are written from each other's state (export offsets, header size),
+		//so they always go dirty together
+		void markDirty() {
+			dirty = true;
+			if (auto pakData = std::get_if<PakAssetData>(&data)) {
+				pakData->pakHeader->dirty = true;
+			}
+		}
 		
 		void serialize(DataBuffer &buffer) {
 			buffer.serialize(name);
@@ -2143,42 +2607,85 @@ struct PakFile {
 			u32 structOffset = buffer.pos - start;
 
 			if (buffer.loading) {
-				size_t currentPos = buffer.pos;
+				//Checked against the whole pak, the buffer may only hold the index
+				i64 pakSize = buffer.ctx<PakFile>().pakSize;
+				if (entryData.offset < 0 || entryData.uncompressedSize < 0 || entryData.offset + structOffset + entryData.uncompressedSize > pakSize) {
+					throw ParseError(name, "entry data lies outside the pak");
+				}
 
-				if (name.find(".uasset") != std::string::npos) {
-					DataBuffer assetBuffer;
-					assetBuffer.buffer = buffer.buffer + entryData.offset + structOffset;
-					assetBuffer.size = entryData.uncompressedSize;
+				dataStart = entryData.offset + structOffset;
+			}
+		}
 
-					AssetHeader header;
-					assetBuffer.serialize(header);
-					data = header;
-				}
-				else if (name.find(".uexp") != std::string::npos) {
-					auto searchStr = name.substr(0, name.size() - 5) + ".uasset";
+		//Where the entry's own bytes start in the pak, filled in when the index is read
+		size_t dataStart = 0;
 
-					PakEntry *foundHeader = nullptr;
-					for (auto &&e : buffer.ctx<PakFile>().entries) {
-						if (e.name == searchStr) {
-							foundHeader = &e;
-						}
-					}
+		bool isHeader() const {
+			return name.find(".uasset") != std::string::npos;
+		}
+
+		bool isExports() const {
+			return name.find(".uexp") != std::string::npos;
+		}
+
+		void loadHeader(DataBuffer &pakBuffer) {
+			try {
+				DataBuffer assetBuffer;
+				assetBuffer.setupMemory(pakBuffer.buffer + dataStart, entryData.uncompressedSize, pakBuffer.mappedFile());
+
+				AssetHeader header;
+				assetBuffer.serialize(header);
+				data = std::move(header);
+			}
+			catch (const ParseError &e) {
+				throw e.within(name);
+			}
 
-					if (foundHeader) {
-						PakAssetData pakData;
-						pakData.pakHeader = foundHeader;
+			keepBytes(pakBuffer.mappedFile(), pakBuffer.buffer + dataStart);
+		}
+
+		//With parse set the exports are parsed right away, otherwise on first use
+		void loadExports(DataBuffer &pakBuffer, PakEntry *header, bool parse) {
+			try {
+				PakAssetData pakData;
+				pakData.pakHeader = header;
 
-						DataBuffer assetBuffer;
-						assetBuffer.buffer = buffer.buffer + entryData.offset + structOffset;
-						assetBuffer.size = entryData.uncompressedSize;
-						assetBuffer.serialize(pakData);
+				DataBuffer assetBuffer;
+				assetBuffer.setupMemory(pakBuffer.buffer + dataStart, entryData.uncompressedSize, pakBuffer.mappedFile());
+				assetBuffer.serialize(pakData);
 
-						data = std::move(pakData);
+				if (parse) {
+					for (auto &&c : pakData.data.catagoryValues) {
+						c.value();
 					}
 				}
 
-				buffer.pos = currentPos;
+				data = std::move(pakData);
+			}
+			catch (const ParseError &e) {
+				throw e.within(name);
+			}
+
+			keepBytes(pakBuffer.mappedFile(), pakBuffer.buffer + dataStart);
+		}
+
+		//Until something changes it, the entry saves as its bytes at data in file, hashed as the
+		//index says. Only for mapped paks, anything else would need a copy of the whole pak.
+		void keepBytes(const std::shared_ptr<MappedFile> &file, const u8 *data) {
+			if (!file || entryData.compressionMethodIdx != 0 || entryData.size != entryData.uncompressedSize) {
+				return;
+			}
+
+			size_t offset = data - file->data();
+			if (offset + entryData.uncompressedSize > file->size()) {
+				return;
 			}
+
+			SavedBytes s;
+			s.bytes.setView(file, offset, entryData.uncompressedSize);
+			s.hash = entryData.hash;
+			saved = std::move(s);
+			dirty = false;
 		}
 	};
 
@@ -2186,64 +2693,486 @@ struct PakFile {
 	Info info_footer;
 	std::string mountPoint;
 	std::vector<PakEntry> entries;
+	//Size of the pak the index was read from
+	i64 pakSize = 0;
+	//Parse every export during the load, spread over the worker threads, instead of on first use.
+	//For callers that are going to walk all of them anyway.
+	bool parseExportsOnLoad = false;
+	//The mapped pak this was loaded from or last saved to, where the entries' saved bytes are
+	std::shared_ptr<MappedFile> file;
+
+	//Index into entries by path, for findEntry
+	std::unordered_map<std::string, size_t> entryIndex;
+	size_t indexedEntries = 0;
+	bool hasDuplicatePaths = false;
 
 	void serialize(DataBuffer &buffer) {
 		buffer.ctx_ = this;
 
 		if (buffer.loading) {
+			file = buffer.mappedFile();
 			buffer.serialize(info_footer);
 			buffer.pos = info_footer.indexOffset;
 
-			buffer.serialize(mountPoint);
-			buffer.serialize(entries);
+			readIndex(buffer, buffer.size);
+
+			loadEntries(buffer);
 		}
 		else {
+			//A .uexp and its .uasset are written from each other's state, one can't be serialized
+			//without the other
+			for (auto &&e : entries) {
+				if (auto pakData = std::get_if<PakEntry::PakAssetData>(&e.data)) {
+					if (e.needsSerializing() || pakData->pakHeader->needsSerializing()) {
+						e.markDirty();
+					}
+				}
+			}
+
+			auto layout = planLayout(buffer.pos);
+			buffer.reserve(layout.totalSize);
+
 			for (auto &&e : entries) {
-				e.entryData.offset = buffer.pos;
+				writeEntry(buffer, e);
+			}
+
+			//The index holds every entry's hash, so it's only complete (and can be hashed) once
+			//they're all in
+			buffer.settleHashFixups();
+			auto index = settledBytes([&](DataBuffer &b) {
+				b.serialize(mountPoint);
+				b.serialize(entries);
+			});
+			info_footer.indexOffset = layout.indexOffset;
+			info_footer.indexSize = layout.indexSize;
+			info_footer.hash = hashOf(index);
+			if ((i64)buffer.pos != layout.indexOffset || (i64)index.size() != layout.indexSize) {
+				__debugbreak();
+			}
+			writeBlock(buffer, index.data(), index.size());
 
-				e.entryData.inFilePrefix = true;
-				buffer.serialize(e.entryData);
-				e.entryData.inFilePrefix = false;
+			buffer.serialize(info_footer);
+			if ((i64)buffer.pos != layout.totalSize) {
+				__debugbreak();
+			}
+		}
+	}
+
+	//Mount point and entries (names, offsets, sizes, hashes) from a buffer positioned at the index.
+	//Entry data isn't touched, that's loadEntries().
+	void readIndex(DataBuffer &buffer, i64 size) {
+		buffer.ctx_ = this;
+		pakSize = size;
 
-				std::visit([&](auto &&d) {
-					DataBuffer b = buffer.setupFromHere();
-					b.serialize(d);
-					buffer.pos = b.pos + b.derivedBuffer->offset;
+		buffer.serialize(mountPoint);
+		buffer.serialize(entries);
+	}
 
-					FinalizeHash fh;
-					fh.start = b.derivedBuffer->offset;
-					fh.size = b.size;
-					fh.hash = &e.entryData.hash;
-					buffer.finalizeFunctions.emplace_back(std::move(fh));
+	//Headers only need their own bytes and exports only need their header, so every header is
+	//parsed at once, then every export. Each entry parses into its own slot. Unless
+	//parseExportsOnLoad is set, the second phase only splits each .uexp into its exports.
+	void loadEntries(DataBuffer &buffer) {
+		rebuildEntryIndex();
+
+		std::vector<PakEntry*> headers;
+		std::vector<std::pair<PakEntry*, PakEntry*>> exports;
+		std::string searchStr;
+		for (auto &&e : entries) {
+			if (e.isHeader()) {
+				headers.emplace_back(&e);
+			}
+			else if (e.isExports()) {
+				searchStr.assign(e.name, 0, e.name.size() - 5);
+				searchStr += ".uasset";
 
-					e.entryData.size = b.size;
-					e.entryData.uncompressedSize = b.size;
-				}, e.data);
+				if (auto foundHeader = findEntry(searchStr)) {
+					exports.emplace_back(&e, foundHeader);
+				}
 			}
+		}
 
-			info_footer.indexOffset = buffer.pos;
-			buffer.serialize(mountPoint);
-			buffer.serialize(entries);
+		parallel::forEach(headers.size(), [&](size_t i) {
+			headers[i]->loadHeader(buffer);
+		});
 
-			info_footer.indexSize = buffer.pos - info_footer.indexOffset;
+		parallel::forEach(exports.size(), [&](size_t i) {
+			exports[i].first->loadExports(buffer, exports[i].second, parseExportsOnLoad);
+		});
+	}
 
-			FinalizeHash fh;
-			fh.start = info_footer.indexOffset;
-			fh.size = info_footer.indexSize;
-			fh.hash = &info_footer.hash;
-			buffer.finalizeFunctions.emplace_back(std::move(fh));
+	//Entry by its full path, nullptr if there isn't one. With duplicate paths the last one wins.
+	PakEntry *findEntry(const std::string &path) {
+		if (indexedEntries != entries.size()) {
+			rebuildEntryIndex();
+		}
 
-			buffer.serialize(info_footer);
+		auto it = entryIndex.find(path);
+		if (it == entryIndex.end()) {
+			return nullptr;
+		}
+
+		return &entries[it->second];
+	}
+
+	//Entry names should only change through here, so findEntry stays in step with them
+	void renameEntry(PakEntry &e, const std::string &name) {
+		if (e.name == name) {
+			return;
+		}
+
+		size_t idx = &e - entries.data();
+		if (hasDuplicatePaths || indexedEntries != entries.size() || entryIndex.count(name)) {
+			e.name = name;
+			rebuildEntryIndex();
+			return;
+		}
+
+		entryIndex.erase(e.name);
+		e.name = name;
+		entryIndex.emplace(name, idx);
+	}
+
+	void rebuildEntryIndex() {
+		entryIndex.clear();
+		entryIndex.reserve(entries.size());
+		hasDuplicatePaths = false;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			auto added = entryIndex.try_emplace(entries[i].name, i);
+			if (!added.second) {
+				added.first->second = i;
+				hasDuplicatePaths = true;
+			}
+		}
+		indexedEntries = entries.size();
+	}
+
+	//Where everything goes in a saved pak, worked out before any of it is written
+	struct Layout {
+		i64 indexOffset = 0;
+		i64 indexSize = 0;
+		i64 totalSize = 0;
+	};
+
+	//Sizes every entry and places them back to back from start, each behind its record, with the
+	//index and footer after them. Entry offsets go straight into the entries.
+	Layout planLayout(i64 start) {
+		sizeDirtyEntries();
+
+		i64 pos = start;
+		for (auto &&e : entries) {
+			if (!e.needsSerializing()) {
+				useSaved(e);
+			}
+
+			e.entryData.offset = pos;
+			e.dataStart = pos + PakEntry::EntryData::SERIALIZED_SIZE;
+			pos = e.dataStart + e.entryData.size;
+		}
+
+		//Every record in the index is the same size whatever its values
+		DataBuffer counter;
+		counter.setupCounting();
+		counter.ctx_ = this;
+		counter.serialize(mountPoint);
+		counter.serialize(entries);
+
+		Layout layout;
+		layout.indexOffset = pos;
+		layout.indexSize = counter.size;
+		layout.totalSize = pos + counter.size + Info::OFFSET;
+		return layout;
+	}
+
+	//Counts how big every entry that has to be serialized comes out, so its record can go out
+	//with its final size ahead of its bytes. Counting exports also settles what they write back
+	//into their header (export offsets, header size), so a header and its exports go through one
+	//worker, exports first, while separate assets run at the same time.
+	void sizeDirtyEntries() {
+		std::vector<std::vector<PakEntry*>> groups;
+		std::unordered_map<PakEntry*, size_t> groupOf;
+		for (auto &&e : entries) {
+			if (!e.needsSerializing()) {
+				continue;
+			}
+
+			PakEntry *owner = &e;
+			if (auto pakData = std::get_if<PakEntry::PakAssetData>(&e.data)) {
+				owner = pakData->pakHeader;
+			}
+
+			auto added = groupOf.try_emplace(owner, groups.size());
+			if (added.second) {
+				groups.emplace_back();
+			}
+
+			auto &&group = groups[added.first->second];
+			if (owner != &e) {
+				group.insert(group.begin(), &e);
+			}
+			else {
+				group.emplace_back(&e);
+			}
+		}
+
+		parallel::forEach(groups.size(), [&](size_t i) {
+			for (auto &&e : groups[i]) {
+				DataBuffer b;
+				b.setupCounting();
+				b.ctx_ = this;
+				std::visit([&](auto &&d) { b.serialize(d); }, e->data);
+
+				e->entryData.size = b.size;
+				e->entryData.uncompressedSize = b.size;
+			}
+		});
+	}
+
+	//The entry's record, then its bytes: copied out of its saved bytes if it's clean, serialized
+	//straight into the pak otherwise. A serialized entry's hash is filled into its record once its
+	//bytes are final. Goes where planLayout() put it.
+	void writeEntry(DataBuffer &buffer, PakEntry &e) {
+		bool serializing = e.needsSerializing();
+		if ((i64)buffer.pos != e.entryData.offset) {
+			__debugbreak();
+		}
+
+		//The hash has to be asked for before its record goes out
+		if (serializing) {
+			buffer.addHashFixup(e.dataStart, e.entryData.size, e.entryData.offset + PakEntry::EntryData::HASH_OFFSET, e.entryData.hash.data);
+		}
+
+		auto record = settledBytes([&](DataBuffer &b) {
+			e.entryData.inFilePrefix = true;
+			b.serialize(e.entryData);
+			e.entryData.inFilePrefix = false;
+		});
+		writeBlock(buffer, record.data(), record.size());
+
+		if (!serializing) {
+			writeBlock(buffer, e.saved->bytes.data(), e.saved->bytes.size());
+			return;
+		}
+
+		DataBuffer b = buffer.setupFromHere();
+		std::visit([&](auto &&d) { b.serialize(d); }, e.data);
+		//Serializing the same state twice can't come out a different size
+		if (b.size != e.entryData.size) {
+			__debugbreak();
+		}
+		buffer.skipPast(b);
+
+		//Only a file saved with saveToFile() is mapped again to take the bytes from
+		e.saved.reset();
+		e.dirty = false;
+	}
+
+	static SHAHash hashOf(const std::vector<u8> &bytes) {
+		SHA1 sha;
+		sha.reset();
+		sha.update(bytes.data(), bytes.size());
+		sha.finalize();
+
+		SHAHash hash;
+		memcpy(hash.data, sha.digest, sizeof(hash.data));
+		return hash;
+	}
+
+	//Serialized on the side with nothing left to patch, for data whose values are already final
+	template<typename Fn>
+	std::vector<u8> settledBytes(Fn &&fn) {
+		std::vector<u8> bytes;
+		DataBuffer b;
+		b.setupVector(bytes);
+		b.loading = false;
+		b.ctx_ = this;
+		fn(b);
+		b.finalize();
+		return bytes;
+	}
+
+	//The entry's size and hash as of its cached bytes
+	void useSaved(PakEntry &e) {
+		auto &&saved = *e.saved;
+		e.entryData.hash = saved.hash;
+		e.entryData.size = saved.bytes.size();
+		e.entryData.uncompressedSize = saved.bytes.size();
+	}
+
+	void writeBlock(DataBuffer &buffer, const u8 *data, size_t size) {
+		DataBuffer b = buffer.setupFromHere();
+		b.serializeBlock((u8*)data, (i32)size);
+		buffer.skipPast(b);
+	}
+
+	//Saves to path. The pak is written next to it under a temporary name that only replaces path
+	//once it's complete, so saving over the pak this was loaded from still reads entries out of the
+	//old file, and a failed save leaves whatever was at path alone. Afterwards every entry's saved
+	//bytes are in the new file. chunkCrcs gets the CRC of every crcChunkSize bytes, for the .sig.
+	//Returns false, with what went wrong in error, if the pak couldn't be written.
+	bool saveToFile(const std::string &path, size_t crcChunkSize, std::vector<u32> &chunkCrcs, std::string &error) {
+		std::string tempPath = path + ".tmp";
+		bool written = false;
+		{
+			FileSink sink;
+			if (!sink.open(tempPath)) {
+				error = "Couldn't open " + tempPath + " for writing.";
+				return false;
+			}
+			sink.trackChunkCrcs(crcChunkSize);
+
+			DataBuffer buffer;
+			buffer.setupFile(sink);
+			serialize(buffer);
+			buffer.finalize();
+
+			chunkCrcs = sink.finishChunkCrcs();
+			written = sink.good();
+		}
+
+		std::error_code ec;
+		if (!written) {
+			std::filesystem::remove(tempPath, ec);
+			error = "Couldn't write " + tempPath + ", is the disk full?";
+			return false;
+		}
+
+		//Stems and textures may still be read out of the file being replaced
+		bool replacingSource = file && std::filesystem::equivalent(file->path(), path, ec);
+		if (replacingSource && !file->releasePath()) {
+			std::filesystem::remove(tempPath, ec);
+			error = "Couldn't replace " + path + ", is it open somewhere else?";
+			return false;
+		}
+
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec) {
+			if (replacingSource) {
+				file->restorePath();
+			}
+			std::filesystem::remove(tempPath, ec);
+			error = "Couldn't replace " + path + ".";
+			return false;
+		}
+
+		keepSavedBytes(MappedFile::open(path));
+		return true;
+	}
+
+	//Entries are saved from the file they were just written to from now on, as they were written
+	void keepSavedBytes(std::shared_ptr<MappedFile> saved) {
+		if (!saved) {
+			return;
+		}
+
+		file = std::move(saved);
+		for (auto &&e : entries) {
+			e.keepBytes(file, file->data() + e.dataStart);
+		}
+	}
+
+	//Drops every entry's saved bytes, the next save serializes everything from scratch
+	void markAllDirty() {
+		for (auto &&e : entries) {
+			e.dirty = true;
+			e.saved.reset();
 		}
 	}
 };
 
+//What's in a pak, from its footer and index alone. Two small reads however big the pak is, for
+//listing paks without loading them.
+struct PakListing {
+	struct Entry {
+		std::string name;
+		i64 offset;
+		i64 size;
+		i64 uncompressedSize;
+		SHAHash hash;
+	};
+
+	std::string mountPoint;
+	std::vector<Entry> entries;
+
+	//nullopt if the file can't be opened, throws ParseError if it isn't a pak
+	static std::optional<PakListing> read(const std::string &path) {
+		std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+		if (!file.is_open()) {
+			return std::nullopt;
+		}
+
+		i64 fileSize = file.tellg();
+		if (fileSize < (i64)PakFile::Info::OFFSET) {
+			throw ParseError("Pak footer", "file is too small to be a pak");
+		}
+
+		std::vector<u8> footer(PakFile::Info::OFFSET);
+		if (!readAt(file, fileSize - footer.size(), footer)) {
+			throw ParseError("Pak footer", "couldn't read the footer");
+		}
+
+		PakFile pak;
+		DataBuffer footerBuffer;
+		footerBuffer.setupVector(footer);
+		footerBuffer.serialize(pak.info_footer);
+
+		auto &&info = pak.info_footer;
+		if (info.indexOffset < 0 || info.indexSize < 0 || info.indexOffset + info.indexSize > fileSize) {
+			throw ParseError("Pak footer", "index lies outside the pak");
+		}
+
+		std::vector<u8> index(info.indexSize);
+		if (!readAt(file, info.indexOffset, index)) {
+			throw ParseError("Pak index", "couldn't read the index");
+		}
+
+		DataBuffer indexBuffer;
+		indexBuffer.setupVector(index);
+		pak.readIndex(indexBuffer, fileSize);
+
+		PakListing listing;
+		listing.mountPoint = std::move(pak.mountPoint);
+		listing.entries.reserve(pak.entries.size());
+		for (auto &&e : pak.entries) {
+			Entry entry;
+			entry.name = std::move(e.name);
+			entry.offset = e.entryData.offset;
+			entry.size = e.entryData.size;
+			entry.uncompressedSize = e.entryData.uncompressedSize;
+			entry.hash = e.entryData.hash;
+			listing.entries.emplace_back(std::move(entry));
+		}
+		return listing;
+	}
+
+private:
+	static bool readAt(std::ifstream &file, i64 at, std::vector<u8> &out) {
+		file.seekg(at);
+		file.read((char*)out.data(), out.size());
+		return file.gcount() == (std::streamsize)out.size();
+	}
+};
+
 struct PakSigFile {
+	//Each entry in chunks is the CRC32 of this many bytes of the pak
+	static const u32 CHUNK_SIZE = 64 * 1024;
+
 	u32 magic = 0x73832DAA;
 	u32 version = 1;
 	std::vector<u8> encrypted_total_hash;
 	std::vector<u32> chunks;
 
+	//CRC of every chunk of a finished pak. The chunks don't depend on each other, so they're spread
+	//over the worker threads.
+	static std::vector<u32> chunkCrcs(const u8 *data, size_t size) {
+		std::vector<u32> crcs((size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+		parallel::forEach(crcs.size(), [&](size_t i) {
+			size_t start = i * CHUNK_SIZE;
+			size_t n = std::min<size_t>(CHUNK_SIZE, size - start);
+			crcs[i] = CRC::MemCrc32(data + start, (i32)n);
+		});
+		return crcs;
+	}
+
 	const unsigned char known_good_hash[512] = {
 		0x98, 0xFE, 0xD5, 0x13, 0x09, 0xE7, 0xB9, 0x85, 0xB1, 0x93, 0x7F, 0x81, 0xC9, 0x20, 0x5F, 0x81,
 		0x79, 0x9B, 0x3B, 0x2E, 0x05, 0x41, 0x77, 0x84, 0x52, 0xB0, 0xD2, 0xE7, 0x13, 0x77, 0x02, 0x9D,
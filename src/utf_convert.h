@@ -0,0 +1,185 @@
+#pragma once
+#include "core_types.h"
+
+#include <cstring>
+
+//UTF-8 <-> UTF-16LE for FStrings. std::string holds UTF-8, paks store either ANSI (Latin-1) or UTF-16LE.
+//Malformed input (bad UTF-8, unpaired surrogates) comes out as U+FFFD instead of throwing.
+namespace utf_convert {
+	static const u32 REPLACEMENT = 0xFFFD;
+
+	//True if nothing in [data, data + len) has the high bit set. Checks a word at a time.
+	inline bool isAscii(const char *data, size_t len) {
+		const char *end = data + len;
+		u64 bits = 0;
+		for (; end - data >= 32; data += 32) {
+			u64 w[4];
+			memcpy(w, data, sizeof(w));
+			bits |= w[0] | w[1] | w[2] | w[3];
+		}
+		for (; end - data >= 8; data += 8) {
+			u64 w;
+			memcpy(&w, data, sizeof(w));
+			bits |= w;
+		}
+		for (; data < end; ++data) {
+			bits |= (u8)*data;
+		}
+		return (bits & 0x8080808080808080ull) == 0;
+	}
+
+	inline u32 readUtf8(const char *&p, const char *end) {
+		u8 c = (u8)*p++;
+		if (c < 0x80) {
+			return c;
+		}
+
+		i32 extra;
+		u32 cp;
+		u32 min;
+		if ((c & 0xE0) == 0xC0) {
+			extra = 1;
+			cp = c & 0x1F;
+			min = 0x80;
+		}
+		else if ((c & 0xF0) == 0xE0) {
+			extra = 2;
+			cp = c & 0x0F;
+			min = 0x800;
+		}
+		else if ((c & 0xF8) == 0xF0) {
+			extra = 3;
+			cp = c & 0x07;
+			min = 0x10000;
+		}
+		else {
+			return REPLACEMENT;
+		}
+
+		for (i32 i = 0; i < extra; ++i) {
+			if (p == end || ((u8)*p & 0xC0) != 0x80) {
+				return REPLACEMENT;
+			}
+			cp = (cp << 6) | ((u8)*p++ & 0x3F);
+		}
+
+		if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+			return REPLACEMENT;
+		}
+		return cp;
+	}
+
+	inline u16 loadUnit(const u8 *p) {
+		return (u16)(p[0] | (p[1] << 8));
+	}
+
+	//p/end walk over UTF-16LE bytes, end - p is always even
+	inline u32 readUtf16(const u8 *&p, const u8 *end) {
+		u16 unit = loadUnit(p);
+		p += 2;
+		if (unit < 0xD800 || unit > 0xDFFF) {
+			return unit;
+		}
+
+		if (unit <= 0xDBFF && p != end) {
+			u16 low = loadUnit(p);
+			if (low >= 0xDC00 && low <= 0xDFFF) {
+				p += 2;
+				return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+			}
+		}
+		return REPLACEMENT;
+	}
+
+	inline size_t writeUtf8(u32 cp, char *out) {
+		if (cp < 0x80) {
+			out[0] = (char)cp;
+			return 1;
+		}
+		if (cp < 0x800) {
+			out[0] = (char)(0xC0 | (cp >> 6));
+			out[1] = (char)(0x80 | (cp & 0x3F));
+			return 2;
+		}
+		if (cp < 0x10000) {
+			out[0] = (char)(0xE0 | (cp >> 12));
+			out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+			out[2] = (char)(0x80 | (cp & 0x3F));
+			return 3;
+		}
+		out[0] = (char)(0xF0 | (cp >> 18));
+		out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+		out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		out[3] = (char)(0x80 | (cp & 0x3F));
+		return 4;
+	}
+
+	//Returns the number of bytes written (2 or 4)
+	inline size_t writeUtf16(u32 cp, u8 *out) {
+		if (cp < 0x10000) {
+			out[0] = (u8)cp;
+			out[1] = (u8)(cp >> 8);
+			return 2;
+		}
+
+		cp -= 0x10000;
+		u16 high = (u16)(0xD800 + (cp >> 10));
+		u16 low = (u16)(0xDC00 + (cp & 0x3FF));
+		out[0] = (u8)high;
+		out[1] = (u8)(high >> 8);
+		out[2] = (u8)low;
+		out[3] = (u8)(low >> 8);
+		return 4;
+	}
+
+	//Number of UTF-16 code units needed for a UTF-8 string
+	inline size_t utf16Length(const char *data, size_t len) {
+		const char *end = data + len;
+		size_t units = 0;
+		while (data < end) {
+			units += readUtf8(data, end) >= 0x10000 ? 2 : 1;
+		}
+		return units;
+	}
+
+	//Number of UTF-8 bytes needed for a UTF-16LE string of the given size in bytes
+	inline size_t utf8Length(const u8 *data, size_t bytes) {
+		const u8 *end = data + bytes;
+		size_t len = 0;
+		while (data < end) {
+			u32 cp = readUtf16(data, end);
+			len += cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+		}
+		return len;
+	}
+
+	//Number of UTF-8 bytes needed for a Latin-1 string, everything past ASCII takes two
+	inline size_t latin1Utf8Length(const u8 *data, size_t len) {
+		size_t high = 0;
+		for (size_t i = 0; i < len; ++i) {
+			high += data[i] >> 7;
+		}
+		return len + high;
+	}
+
+	//Decodes Latin-1 into out, which must have room for latin1Utf8Length() bytes
+	inline void latin1ToUtf8(const u8 *data, size_t len, char *out) {
+		for (size_t i = 0; i < len; ++i) {
+			out += writeUtf8(data[i], out);
+		}
+	}
+
+	//Decodes UTF-16LE into out, which must have room for utf8Length() bytes
+	inline void utf16ToUtf8(const u8 *data, size_t bytes, char *out) {
+		const u8 *end = data + bytes;
+		while (data < end) {
+			//Runs of ASCII are the common case, even in otherwise non-Latin titles
+			if (data[1] == 0 && data[0] < 0x80) {
+				*out++ = (char)data[0];
+				data += 2;
+				continue;
+			}
+			out += writeUtf8(readUtf16(data, end), out);
+		}
+	}
+}
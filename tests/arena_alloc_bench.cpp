@@ -0,0 +1,78 @@
+#include "bench_common.h"
+
+#include <atomic>
+#include <new>
+
+//Heap allocations for loading a pak with a few thousand property nodes and closing it again,
+//100 times. Every node comes from the entry's arena, which a close releases in one go.
+
+static std::atomic<size_t> allocations{ 0 };
+
+void *operator new(size_t size) {
+	++allocations;
+	if (void *p = malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static const i32 cycles = 100;
+
+int main() {
+	std::vector<u8> bytes;
+	{
+		PakFile pak = test_pak::build("Bench Song", 1024);
+		auto &&h = pak.entries[0].getHeader();
+		auto &&nodes = *std::get<PakFile::PakEntry::PakAssetData>(pak.entries[1].data).arena;
+		for (auto &&p : test_pak::meta(pak).data.properties) {
+			if (auto arr = std::get_if<ArrayProperty>(&p.value)) {
+				for (i32 i = 0; i < 3000; ++i) {
+					auto v = nodes.make<IPropertyValue>();
+					PrimitiveProperty<i32> beat{};
+					beat.data = i;
+					v->v = beat;
+					arr->values.push_back(v);
+				}
+			}
+			else if (auto st = std::get_if<StructProperty>(&p.value)) {
+				for (i32 i = 0; i < 500; ++i) {
+					auto list = nodes.make<IPropertyDataList>();
+					for (i32 k = 0; k < 3; ++k) {
+						PrimitiveProperty<i32> val{};
+						val.data = k;
+						list->properties.push_back(test_pak::prop(h, "Inner" + std::to_string(k), "IntProperty", val, 4));
+					}
+					auto v = nodes.make<IPropertyValue>();
+					v->v = list;
+					st->values.push_back(v);
+				}
+			}
+		}
+		bytes = test_pak::save(pak);
+	}
+
+	size_t nodeCount = 0;
+	size_t before = allocations;
+	double ms = bench::bestMs(1, [&]() {
+		for (i32 i = 0; i < cycles; ++i) {
+			PakFile pak;
+			DataBuffer in;
+			in.setupVector(bytes);
+			in.serialize(pak);
+			test_pak::meta(pak);
+			nodeCount = std::get<PakFile::PakEntry::PakAssetData>(pak.entries[1].data).arena->objects();
+		}
+	});
+	double perCycle = (double)(allocations - before) / cycles;
+
+	printf("%zu byte pak, %zu arena nodes per load\n", bytes.size(), nodeCount);
+	printf("%.1f heap allocations and %.2f ms per load and close\n", perCycle, ms / cycles);
+	return testResult();
+}
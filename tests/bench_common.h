@@ -0,0 +1,27 @@
+#pragma once
+#include "test_common.h"
+
+#include <chrono>
+
+//Benchmarks print their numbers rather than check them, ctest doesn't run them. Build them
+//optimized (CMAKE_BUILD_TYPE=Release) before reading anything into the results.
+namespace bench {
+	//Best of a few runs, in milliseconds, so one descheduled run doesn't skew the number
+	template<typename F>
+	double bestMs(i32 runs, F &&fn) {
+		double best = 0;
+		for (i32 r = 0; r < runs; ++r) {
+			auto start = std::chrono::steady_clock::now();
+			fn();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (r == 0 || ms < best) {
+				best = ms;
+			}
+		}
+		return best;
+	}
+
+	inline double mbPerSec(size_t bytes, double ms) {
+		return bytes / (ms / 1000) / (1024 * 1024);
+	}
+}
@@ -0,0 +1,90 @@
+#include "test_common.h"
+
+#include <random>
+
+//Every MemCrc32 kernel the CPU can run has to give the plain bit-at-a-time CRC32, for any length,
+//alignment and seed, and continuing from a previous CRC has to match doing it in one go.
+
+static u32 bitwiseCrc32(const u8 *data, size_t size, u32 crc = 0) {
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i) {
+		crc ^= data[i];
+		for (i32 bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+static const CRC::Impl allImpls[] = { CRC::Impl::SliceBy16, CRC::Impl::Pclmul, CRC::Impl::ArmV8 };
+
+static void knownVector() {
+	for (auto impl : allImpls) {
+		if (!CRC::SetImplementation(impl)) {
+			continue;
+		}
+
+		CHECK(CRC::MemCrc32("123456789", 9) == 0xCBF43926);
+		CHECK(CRC::MemCrc32("", 0) == 0);
+	}
+}
+
+static void matchesBitwise() {
+	std::mt19937 rng(5);
+	std::vector<u8> data(300000);
+	for (auto &&b : data) {
+		b = (u8)rng();
+	}
+
+	size_t cases = 0;
+	for (i32 c = 0; c < 2000; ++c) {
+		size_t offset = rng() % 64;
+		size_t size = c < 1800 ? rng() % 600 : rng() % (data.size() - 64);
+		u32 seed = (c & 1) ? (u32)rng() : 0;
+		size_t cut = size ? rng() % size : 0;
+		const u8 *at = data.data() + offset;
+
+		u32 expected = bitwiseCrc32(at, size, seed);
+		for (auto impl : allImpls) {
+			if (!CRC::SetImplementation(impl)) {
+				continue;
+			}
+
+			CHECK(CRC::MemCrc32(at, (i32)size, seed) == expected);
+
+			u32 head = CRC::MemCrc32(at, (i32)cut, seed);
+			CHECK(CRC::MemCrc32(at + cut, (i32)(size - cut), head) == expected);
+			++cases;
+		}
+	}
+
+	for (auto impl : allImpls) {
+		printf("%s: %s\n", CRC::Name(impl), CRC::Supported(impl) ? "checked" : "not supported here");
+	}
+	CHECK(cases >= 2000);
+}
+
+//The sig file's chunk CRCs are computed in parallel, they have to match doing it chunk by chunk
+static void sigChunks() {
+	std::vector<u8> data(5 * PakSigFile::CHUNK_SIZE + 123);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (u8)(i * 31 + (i >> 9));
+	}
+
+	auto crcs = PakSigFile::chunkCrcs(data.data(), data.size());
+	CHECK(crcs.size() == 6);
+	for (size_t i = 0; i < crcs.size(); ++i) {
+		size_t start = i * PakSigFile::CHUNK_SIZE;
+		size_t n = std::min<size_t>(PakSigFile::CHUNK_SIZE, data.size() - start);
+		CHECK(crcs[i] == bitwiseCrc32(data.data() + start, n));
+	}
+}
+
+int main() {
+	auto original = CRC::Implementation();
+	knownVector();
+	matchesBitwise();
+	CRC::SetImplementation(original);
+	sigChunks();
+	return testResult();
+}
@@ -0,0 +1,119 @@
+#include "test_common.h"
+
+//FStrings hold UTF-8 in memory and go out as ANSI or UTF-16LE. Writing and reading back has to give
+//the same string, in the size stringSize says, and song titles in other scripts have to survive
+//a pak round trip.
+
+//UTF-8 for the titles, spelled out so the source file's encoding doesn't matter
+static const std::string korean = "\xEC\x82\xAC\xEB\x9E\x91\xEC\x9D\x98 \xEB\x85\xB8\xEB\x9E\x98"; //사랑의 노래
+static const std::string japanese = "\xE5\xA4\x9C\xE3\x81\xAB\xE9\xA7\x86\xE3\x81\x91\xE3\x82\x8B"; //夜に駆ける
+static const std::string mixed = "Gurenge (\xE7\xB4\x85\xE8\x93\xAE\xE8\x8F\xAF) feat. \xEC\x95\x84\xEC\x9D\xB4\xEC\x9C\xA0"; //紅蓮華, 아이유
+static const std::string emoji = "Fire \xF0\x9F\x94\xA5"; //Outside the BMP, a surrogate pair in UTF-16
+
+static std::vector<u8> write(std::string str, bool nullTerminated) {
+	std::vector<u8> bytes;
+	DataBuffer out;
+	out.setupVector(bytes);
+	out.loading = false;
+	if (nullTerminated) {
+		out.serialize(str);
+	}
+	else {
+		out.serialize_nonull(str);
+	}
+	out.finalize();
+	bytes.resize(out.size);
+	return bytes;
+}
+
+static std::string read(std::vector<u8> &bytes, bool nullTerminated) {
+	std::string str;
+	DataBuffer in;
+	in.setupVector(bytes);
+	if (nullTerminated) {
+		in.serialize(str);
+	}
+	else {
+		in.serialize_nonull(str);
+	}
+	CHECK(in.pos == bytes.size());
+	return str;
+}
+
+static void roundTrips() {
+	for (auto &&str : { std::string(), std::string("Test Song"), korean, japanese, mixed, emoji }) {
+		auto bytes = write(str, true);
+		CHECK(bytes.size() == DataBuffer::stringSize(str.data(), str.size()));
+		CHECK(read(bytes, true) == str);
+
+		auto nonull = write(str, false);
+		CHECK(nonull.size() == DataBuffer::stringSize(str.data(), str.size(), false));
+		CHECK(read(nonull, false) == str);
+	}
+}
+
+static void encodings() {
+	//Plain ASCII stays ANSI, with its terminator
+	auto ascii = write("abc", true);
+	CHECK((ascii == std::vector<u8>{ 4, 0, 0, 0, 'a', 'b', 'c', 0 }));
+
+	//Without one the length counts just the characters
+	auto asciiNonull = write("abc", false);
+	CHECK((asciiNonull == std::vector<u8>{ 3, 0, 0, 0, 'a', 'b', 'c' }));
+	CHECK(DataBuffer::stringSize("abc", 3, false) == 7);
+
+	//Anything else is UTF-16LE, with a negative length in code units
+	auto hangul = write("\xED\x95\x9C", true); //한, U+D55C
+	CHECK((hangul == std::vector<u8>{ 0xFE, 0xFF, 0xFF, 0xFF, 0x5C, 0xD5, 0, 0 }));
+
+	auto pair = write(emoji, true);
+	CHECK(pair.size() == 4 + (5 + 2 + 1) * 2);
+	CHECK(pair[4 + 10] == 0x3D && pair[4 + 11] == 0xD8 && pair[4 + 12] == 0x25 && pair[4 + 13] == 0xDD);
+}
+
+//ANSI FStrings are Latin-1, other tools write accented names that way
+static void latin1() {
+	std::vector<u8> bytes = { 7, 0, 0, 0, 'B', 'e', 'y', 'o', 'n', 0xE9, 0 };
+	std::string str = read(bytes, true);
+	CHECK(str == "Beyon\xC3\xA9");
+
+	//Written back the way UE would, as UTF-16
+	auto written = write(str, true);
+	CHECK(written.size() == 4 + 7 * 2);
+	CHECK(read(written, true) == str);
+}
+
+//Malformed input comes out as U+FFFD instead of failing the load
+static void unpairedSurrogate() {
+	std::vector<u8> bytes = { 0xFD, 0xFF, 0xFF, 0xFF, 'a', 0, 0x00, 0xD8, 0, 0 };
+	CHECK(read(bytes, true) == "a\xEF\xBF\xBD");
+}
+
+static void songTitles() {
+	for (auto &&title : { korean, japanese, mixed }) {
+		PakFile pak = test_pak::build(title, 1024);
+		auto bytes = test_pak::save(pak);
+
+		PakFile loaded;
+		test_pak::load(loaded, bytes);
+		auto &&header = loaded.entries[0].getHeader();
+		auto titleProp = test_pak::meta(loaded).data.get(&header, "Title");
+		CHECK(titleProp != nullptr);
+		if (titleProp) {
+			auto &&strings = std::get<TextProperty>(titleProp->value).strings;
+			CHECK(strings.size() == 1 && strings[0] == title);
+		}
+
+		loaded.markAllDirty();
+		CHECK(test_pak::save(loaded) == bytes);
+	}
+}
+
+int main() {
+	roundTrips();
+	encodings();
+	latin1();
+	unpairedSurrogate();
+	songTitles();
+	return testResult();
+}
@@ -0,0 +1,167 @@
+#include "bench_common.h"
+#include "cpu_features.h"
+
+#include <random>
+
+//Throughput of every SHA-1 and CRC-32 implementation this CPU can run. On x86 it also times the
+//SSSE3 vectorized message schedule that was tried before SHA-NI, to show why it isn't in sha1.cpp.
+
+static const size_t bufferSize = 64 * 1024 * 1024;
+
+static std::vector<u8> randomBytes(size_t size) {
+	std::mt19937 rng(7);
+	std::vector<u8> bytes(size);
+	for (auto &&b : bytes) {
+		b = (u8)rng();
+	}
+	return bytes;
+}
+
+#ifdef CPU_X86
+//The scalar rounds with the schedule done four words at a time in SSE registers, the way the
+//SSSE3 paths in OpenSSL and the Linux kernel do it. The rounds themselves can't be vectorized.
+static const u32 roundConstants[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+#define ROL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define CH(x, y, z) (((x) & ((y) ^ (z))) ^ (z))
+#define PARITY(x, y, z) ((x) ^ (y) ^ (z))
+#define MAJ(x, y, z) ((((x) | (y)) & (z)) | ((x) & (y)))
+#define ROUND(v, w, x, y, z, i, f) z += f(w, x, y) + wk[i] + ROL(v, 5); w = ROL(w, 30);
+#define FIVE_ROUNDS(i, f) \
+	ROUND(a, b, c, d, e, (i), f) ROUND(e, a, b, c, d, (i) + 1, f) ROUND(d, e, a, b, c, (i) + 2, f) \
+	ROUND(c, d, e, a, b, (i) + 3, f) ROUND(b, c, d, e, a, (i) + 4, f)
+
+//Words 4n to 4n + 3 of the schedule from the sixteen before them, plus their round constant.
+//The last of the four depends on the first, which the second rotate-and-xor fixes up.
+#define SCHEDULE(n) { \
+	__m128i x = _mm_xor_si128(w[(n) - 4], w[(n) - 2]); \
+	x = _mm_xor_si128(x, _mm_alignr_epi8(w[(n) - 3], w[(n) - 4], 8)); \
+	x = _mm_xor_si128(x, _mm_srli_si128(w[(n) - 1], 4)); \
+	__m128i rotated = _mm_or_si128(_mm_slli_epi32(x, 1), _mm_srli_epi32(x, 31)); \
+	__m128i fix = _mm_slli_si128(x, 12); \
+	fix = _mm_or_si128(_mm_slli_epi32(fix, 2), _mm_srli_epi32(fix, 30)); \
+	w[n] = _mm_xor_si128(rotated, fix); \
+	_mm_store_si128((__m128i*)(wk + (n) * 4), _mm_add_epi32(w[n], _mm_set1_epi32((int)roundConstants[(n) / 5]))); \
+}
+
+CPU_TARGET("ssse3")
+static void blocksSsse3(u32 *state, const u8 *data, size_t count) {
+	const __m128i byteSwap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	alignas(16) u32 wk[80];
+
+	for (; count > 0; --count, data += 64) {
+		__m128i w[20];
+		for (int i = 0; i < 4; ++i) {
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), byteSwap);
+			_mm_store_si128((__m128i*)(wk + i * 4), _mm_add_epi32(w[i], _mm_set1_epi32((int)roundConstants[0])));
+		}
+		for (int n = 4; n < 20; ++n) {
+			SCHEDULE(n);
+		}
+
+		u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+		FIVE_ROUNDS(0, CH) FIVE_ROUNDS(5, CH) FIVE_ROUNDS(10, CH) FIVE_ROUNDS(15, CH)
+		FIVE_ROUNDS(20, PARITY) FIVE_ROUNDS(25, PARITY) FIVE_ROUNDS(30, PARITY) FIVE_ROUNDS(35, PARITY)
+		FIVE_ROUNDS(40, MAJ) FIVE_ROUNDS(45, MAJ) FIVE_ROUNDS(50, MAJ) FIVE_ROUNDS(55, MAJ)
+		FIVE_ROUNDS(60, PARITY) FIVE_ROUNDS(65, PARITY) FIVE_ROUNDS(70, PARITY) FIVE_ROUNDS(75, PARITY)
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+//The candidate only has a block function, so it's padded here to compare digests with SHA1
+static std::string ssse3Digest(const std::vector<u8> &data) {
+	u32 state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	size_t whole = data.size() / 64;
+	blocksSsse3(state, data.data(), whole);
+
+	std::vector<u8> tail(data.begin() + whole * 64, data.end());
+	u64 bits = (u64)data.size() * 8;
+	tail.push_back(0x80);
+	while (tail.size() % 64 != 56) {
+		tail.push_back(0);
+	}
+	for (int i = 7; i >= 0; --i) {
+		tail.push_back((u8)(bits >> (i * 8)));
+	}
+	blocksSsse3(state, tail.data(), tail.size() / 64);
+
+	std::string digest;
+	for (u32 s : state) {
+		for (int i = 3; i >= 0; --i) {
+			digest += (char)(s >> (i * 8));
+		}
+	}
+	return digest;
+}
+#endif
+
+static std::string sha1Of(const std::vector<u8> &data) {
+	SHA1 sha;
+	sha.reset();
+	sha.update(data.data(), data.size());
+	sha.finalize();
+	return std::string(sha.digest, sizeof(sha.digest));
+}
+
+static void sha1() {
+	auto data = randomBytes(bufferSize);
+	SHA1::setImplementation(SHA1::Impl::Scalar);
+	std::string reference = sha1Of(data);
+
+	for (auto impl : { SHA1::Impl::Scalar, SHA1::Impl::ShaNi, SHA1::Impl::ArmV8 }) {
+		if (!SHA1::setImplementation(impl)) {
+			printf("SHA-1 %-12s not supported\n", SHA1::name(impl));
+			continue;
+		}
+		std::string digest;
+		double ms = bench::bestMs(3, [&]() { digest = sha1Of(data); });
+		CHECK(digest == reference);
+		printf("SHA-1 %-12s %7.0f MB/s\n", SHA1::name(impl), bench::mbPerSec(data.size(), ms));
+	}
+
+#ifdef CPU_X86
+	if (cpu::x86().ssse3) {
+		std::string digest;
+		double ms = bench::bestMs(3, [&]() { digest = ssse3Digest(data); });
+		CHECK(digest == reference);
+		printf("SHA-1 %-12s %7.0f MB/s (not shipped)\n", "SSSE3 sched", bench::mbPerSec(data.size(), ms));
+	}
+#endif
+}
+
+//Chunked like the .sig CRCs, which is what the save spends its CRC time on
+static void crc32() {
+	auto data = randomBytes(bufferSize);
+	const size_t chunk = 64 * 1024;
+	auto crcAll = [&]() {
+		u32 combined = 0;
+		for (size_t at = 0; at < data.size(); at += chunk) {
+			combined ^= CRC::MemCrc32(data.data() + at, (i32)chunk);
+		}
+		return combined;
+	};
+
+	CRC::SetImplementation(CRC::Impl::SliceBy16);
+	u32 reference = crcAll();
+
+	for (auto impl : { CRC::Impl::SliceBy16, CRC::Impl::Pclmul, CRC::Impl::ArmV8 }) {
+		if (!CRC::SetImplementation(impl)) {
+			printf("CRC   %-12s not supported\n", CRC::Name(impl));
+			continue;
+		}
+		u32 result = 0;
+		double ms = bench::bestMs(3, [&]() { result = crcAll(); });
+		CHECK(result == reference);
+		printf("CRC   %-12s %7.0f MB/s\n", CRC::Name(impl), bench::mbPerSec(data.size(), ms));
+	}
+}
+
+int main() {
+	sha1();
+	crc32();
+	return testResult();
+}
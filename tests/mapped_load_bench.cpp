@@ -0,0 +1,67 @@
+#include "bench_common.h"
+#include "mapped_file.h"
+
+#include <fstream>
+
+//Loading a pak with a big mogg from a heap copy of the file, the way the app used to, against
+//loading it straight from a mapping. Both parse every export, the moggs stay unread.
+
+static const size_t moggSize = 256 * 1024 * 1024;
+static const char *path = "mapped_load_bench.pak";
+
+//Resident set of this process, 0 where there's no /proc to ask
+static size_t residentBytes() {
+	std::ifstream statm("/proc/self/statm");
+	size_t pages = 0, resident = 0;
+	if (!(statm >> pages >> resident)) {
+		return 0;
+	}
+	return resident * 4096;
+}
+
+static void parseAll(PakFile &pak) {
+	for (auto &&e : pak.entries) {
+		if (auto data = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
+			for (auto &&c : data->data.catagoryValues) {
+				c.value();
+			}
+		}
+	}
+}
+
+int main() {
+	{
+		PakFile pak = test_pak::build("Bench Song", moggSize);
+		test_pak::writeFile(path, test_pak::save(pak));
+	}
+
+	//Each load's RSS is taken while the pak is still open, against what was resident before it
+	size_t heapRss = 0, mappedRss = 0;
+	double heapMs = bench::bestMs(3, [&]() {
+		size_t before = residentBytes();
+		std::vector<u8> bytes = test_pak::readFile(path);
+		PakFile pak;
+		DataBuffer in;
+		in.setupVector(bytes);
+		in.serialize(pak);
+		parseAll(pak);
+		heapRss = residentBytes() - before;
+		CHECK(test_pak::song(pak).audio.audioFiles[0].fileData.size() == moggSize);
+	});
+	double mappedMs = bench::bestMs(3, [&]() {
+		size_t before = residentBytes();
+		PakFile pak;
+		DataBuffer in;
+		in.setupMapped(MappedFile::open(path));
+		in.serialize(pak);
+		parseAll(pak);
+		mappedRss = residentBytes() - before;
+		CHECK(test_pak::song(pak).audio.audioFiles[0].fileData.size() == moggSize);
+	});
+	std::remove(path);
+
+	printf("%zu MB pak, file in the page cache\n", moggSize >> 20);
+	printf("heap copy: load %7.1f ms, %6.1f MB resident\n", heapMs, heapRss / (1024.0 * 1024));
+	printf("mapped:    load %7.1f ms, %6.1f MB resident\n", mappedMs, mappedRss / (1024.0 * 1024));
+	return testResult();
+}
@@ -0,0 +1,50 @@
+#include "bench_common.h"
+
+//findName and findOrCreateName on headers with a few thousand names, against the linear scan
+//over names they did before the header kept an index. The indexed time should stay flat.
+
+static const i32 lookups = 200000;
+
+static std::string assetName(i32 i) {
+	return "/Game/Audio/Songs/custom_song_" + std::to_string(i) + "/Meta_custom_song_" + std::to_string(i);
+}
+
+int main() {
+	for (i32 count : { 100, 1000, 5000, 20000 }) {
+		AssetHeader h;
+		std::vector<std::string> queries;
+		for (i32 i = 0; i < count; ++i) {
+			h.findOrCreateName(assetName(i));
+			queries.push_back(assetName((i * 7919) % count));
+		}
+
+		i64 found = 0;
+		double linearMs = bench::bestMs(3, [&]() {
+			for (i32 k = 0; k < lookups; ++k) {
+				auto &&str = queries[k % count];
+				for (size_t i = 0; i < h.names.size(); ++i) {
+					if (h.names[i] == str) {
+						found += i;
+						break;
+					}
+				}
+			}
+		});
+		double findMs = bench::bestMs(3, [&]() {
+			for (i32 k = 0; k < lookups; ++k) {
+				found += h.findName(queries[k % count]).ref;
+			}
+		});
+		double createMs = bench::bestMs(3, [&]() {
+			for (i32 k = 0; k < lookups; ++k) {
+				found += h.findOrCreateName(queries[k % count]).ref;
+			}
+		});
+		CHECK(h.names.size() == (size_t)count);
+		CHECK(found > 0);
+
+		printf("%6d names: linear scan %8.1f ns, findName %5.1f ns, findOrCreateName %5.1f ns per lookup\n", count,
+			linearMs * 1e6 / lookups, findMs * 1e6 / lookups, createMs * 1e6 / lookups);
+	}
+	return testResult();
+}
@@ -0,0 +1,127 @@
+#include "test_common.h"
+
+#include <random>
+
+//findName has to keep giving the first name equal to the string, the way a linear search would,
+//through renames, duplicates and copies, and every name's hashes have to stay those of its string.
+//Property lookups by name have to agree with a linear search the same way.
+
+static i32 linearFind(const AssetHeader &h, const std::string &str) {
+	for (size_t i = 0; i < h.names.size(); ++i) {
+		if (h.names[i] == str) {
+			return (i32)i;
+		}
+	}
+	return std::numeric_limits<i32>::max();
+}
+
+static bool hashesMatch(const AssetHeader &h) {
+	for (size_t i = 0; i < h.names.size(); ++i) {
+		auto &&e = h.names.entry(i);
+		NameTable::Entry expected = e;
+		NameTable::setHashes(expected, h.names[i]);
+		if (e.nonCasePreservingHash != expected.nonCasePreservingHash || e.casePreservingHash != expected.casePreservingHash) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void renamesAndDuplicates() {
+	std::mt19937 rng(1);
+	AssetHeader h;
+	size_t mismatches = 0;
+
+	for (i32 step = 0; step < 5000; ++step) {
+		std::string str = "Name_" + std::to_string(rng() % 50);
+		switch (rng() % 3) {
+		case 0:
+			h.findOrCreateName(str);
+			break;
+		case 1:
+			if (!h.names.empty()) {
+				h.renameName(rng() % h.names.size(), str);
+			}
+			break;
+		case 2:
+			//Loaded headers can hold the same name twice
+			if (!h.names.empty()) {
+				h.names.add(h.names[rng() % h.names.size()]);
+				h.rebuildNameIndex();
+			}
+			break;
+		}
+
+		for (i32 q = 0; q < 50; ++q) {
+			std::string key = "Name_" + std::to_string(q);
+			if (h.findName(key).ref != linearFind(h, key)) {
+				++mismatches;
+			}
+		}
+	}
+
+	CHECK(mismatches == 0);
+	CHECK(hashesMatch(h));
+
+	AssetHeader copy = h;
+	for (size_t i = 0; i < h.names.size(); ++i) {
+		std::string str(h.names[i]);
+		CHECK(copy.findName(str).ref == h.findName(str).ref);
+	}
+}
+
+static void renamedHeaderRoundTrips() {
+	AssetHeader h = test_pak::header("FuserSongMeta");
+	h.renameName(h.catagories[0].objectName, "Meta_renamed_to_something_longer");
+	i32 korean = h.findOrCreateName("\xED\x95\x9C\xEA\xB8\x80").ref;
+	CHECK(hashesMatch(h));
+
+	std::vector<u8> bytes;
+	DataBuffer out;
+	out.setupVector(bytes);
+	out.loading = false;
+	out.serialize(h);
+	out.finalize();
+	bytes.resize(out.size);
+	CHECK(h.totalHeaderSize == (i32)bytes.size());
+
+	AssetHeader loaded;
+	DataBuffer in;
+	in.setupVector(bytes);
+	in.serialize(loaded);
+
+	CHECK(loaded.names.size() == h.names.size());
+	for (size_t i = 0; i < h.names.size() && i < loaded.names.size(); ++i) {
+		CHECK(loaded.names[i] == h.names[i]);
+	}
+	CHECK((u64)loaded.findName("Meta_renamed_to_something_longer").ref == h.catagories[0].objectName);
+	CHECK(loaded.findName("\xED\x95\x9C\xEA\xB8\x80").ref == korean);
+	CHECK(hashesMatch(loaded));
+}
+
+//Property lookups go through an index by name ref, which has to notice a nameRef edited in place
+static void propertyLookupAfterInPlaceEdit() {
+	PakFile pak = test_pak::build();
+	auto &&header = pak.entries[0].getHeader();
+	auto &&data = test_pak::meta(pak).data;
+
+	auto bpm = data.get(&header, "BPM");
+	CHECK(bpm != nullptr);
+	CHECK(data.get(&header, "IntProperty") == nullptr);
+	if (!bpm) {
+		return;
+	}
+
+	//A name the header already has, so nothing about the header changes
+	bpm->nameRef.ref = header.findName("IntProperty").ref;
+	CHECK(data.get(&header, "IntProperty") == bpm);
+	CHECK(data.get(&header, "BPM") == nullptr);
+	CHECK(data.get(&header, "Gain") != nullptr);
+}
+
+int main() {
+	renamesAndDuplicates();
+	renamedHeaderRoundTrips();
+	propertyLookupAfterInPlaceEdit();
+	return testResult();
+}
@@ -0,0 +1,345 @@
+#include "test_common.h"
+
+//Saving, loading and saving again has to give back the same bytes, however the pak was loaded
+//and wherever it was written to.
+
+static void resaveIsIdentical() {
+	PakFile pak = test_pak::build();
+	auto first = test_pak::save(pak);
+
+	PakFile loaded;
+	test_pak::load(loaded, first);
+	CHECK(loaded.entries.size() == 4);
+	CHECK(test_pak::save(loaded) == first);
+
+	//Same again once every export has been parsed instead of passed through
+	PakFile parsed;
+	test_pak::load(parsed, first);
+	for (auto &&e : parsed.entries) {
+		if (auto pakData = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
+			for (auto &&c : pakData->data.catagoryValues) {
+				c.value();
+			}
+		}
+	}
+	CHECK(test_pak::song(parsed).audio.audioFiles[0].fileData.size() == 5 * 1024 * 1024 + 17);
+	CHECK(test_pak::save(parsed) == first);
+}
+
+//Parsing the exports during the load leaves nothing to parse on first use
+static void parseExportsOnLoad() {
+	PakFile pak = test_pak::build();
+	auto bytes = test_pak::save(pak);
+
+	PakFile loaded;
+	loaded.parseExportsOnLoad = true;
+	test_pak::load(loaded, bytes);
+	for (auto &&e : loaded.entries) {
+		if (auto pakData = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
+			for (auto &&c : pakData->data.catagoryValues) {
+				CHECK(!c.unparsed);
+			}
+		}
+	}
+	CHECK(test_pak::song(loaded).audio.audioFiles[0].fileData.size() == 5 * 1024 * 1024 + 17);
+	CHECK(test_pak::save(loaded) == bytes);
+}
+
+//Exports are saved before their header, their offsets have to follow the header's new size
+static void headerGrowthMovesExports() {
+	PakFile pak = test_pak::build();
+	PakFile loaded;
+	test_pak::load(loaded, test_pak::save(pak));
+
+	auto &&header = loaded.entries[0].getHeader();
+	header.renameName(header.catagories[0].objectName, "Meta_test_with_a_much_longer_object_name");
+	loaded.entries[1].markDirty();
+	auto renamed = test_pak::save(loaded);
+
+	PakFile reloaded;
+	test_pak::load(reloaded, renamed);
+	auto &&reloadedHeader = reloaded.entries[0].getHeader();
+	CHECK(reloadedHeader.getHeaderRef(reloadedHeader.catagories[0].objectName) == "Meta_test_with_a_much_longer_object_name");
+
+	//As written, the export starts right after the header
+	AssetHeader written;
+	DataBuffer headerBuffer;
+	headerBuffer.setupMemory(renamed.data() + reloaded.entries[0].dataStart, reloaded.entries[0].entryData.uncompressedSize);
+	headerBuffer.serialize(written);
+	CHECK(written.totalHeaderSize == reloaded.entries[0].entryData.uncompressedSize);
+	CHECK(written.catagories[0].startV == written.totalHeaderSize);
+	CHECK(written.catagories[0].lengthV + 4 == reloaded.entries[1].entryData.uncompressedSize);
+
+	auto &&meta = test_pak::meta(reloaded);
+	auto bpm = meta.data.get(&reloadedHeader, "BPM");
+	CHECK(bpm && std::get<PrimitiveProperty<i32>>(bpm->value).data == 128);
+
+	loaded.markAllDirty();
+	CHECK(test_pak::save(loaded) == renamed);
+}
+
+//The plan says where everything goes before it's written, and how big the output gets
+static void layoutIsExact() {
+	PakFile pak = test_pak::build();
+	auto layout = pak.planLayout(0);
+	std::vector<i64> offsets;
+	for (auto &&e : pak.entries) {
+		offsets.push_back(e.entryData.offset);
+	}
+
+	std::vector<u8> bytes;
+	DataBuffer buffer;
+	buffer.setupVector(bytes);
+	buffer.loading = false;
+	pak.serialize(buffer);
+	buffer.finalize();
+
+	CHECK(layout.totalSize == buffer.size);
+	//Allocated once, at the planned size
+	CHECK(bytes.capacity() == (size_t)layout.totalSize);
+	CHECK(layout.indexOffset == pak.info_footer.indexOffset);
+	CHECK(layout.indexSize == pak.info_footer.indexSize);
+	for (size_t i = 0; i < offsets.size(); ++i) {
+		CHECK(offsets[i] == pak.entries[i].entryData.offset);
+	}
+}
+
+static void fileSinkMatchesVector() {
+	PakFile pak = test_pak::build();
+	auto expected = test_pak::save(pak);
+
+	std::vector<u32> crcs;
+	{
+		PakFile streamed = test_pak::build();
+		FileSink sink;
+		CHECK(sink.open("resave_test.pak"));
+		sink.trackChunkCrcs(PakSigFile::CHUNK_SIZE);
+
+		DataBuffer buffer;
+		buffer.setupFile(sink);
+		streamed.serialize(buffer);
+		buffer.finalize();
+		crcs = sink.finishChunkCrcs();
+	}
+
+	CHECK(test_pak::readFile("resave_test.pak") == expected);
+	CHECK(crcs == PakSigFile::chunkCrcs(expected.data(), expected.size()));
+}
+
+//Hashes a file fills in as it streams out have to come out the same as hashing the finished
+//bytes, records and CRCs included: a record straddling two CRC chunks, ranges that skip the window
+//or span several, an empty one, and one in the last partial chunk
+static void fileSinkFillsHashes() {
+	const size_t chunkSize = 1000;
+	std::vector<size_t> sizes = { 5000, FileSink::WINDOW_SIZE + 123, 0, FileSink::WINDOW_SIZE * 2, 777 };
+	std::vector<size_t> pieces = { 5000, FileSink::WINDOW_SIZE + 123, 1, 65536, 100 };
+
+	std::vector<u8> data(FileSink::WINDOW_SIZE * 2);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (u8)((i * 2654435761u) >> 24);
+	}
+
+	auto write = [&](DataBuffer &buffer, std::vector<SHAHash> &digests) {
+		digests.resize(sizes.size());
+		std::vector<u8> filler(990, 0x5A);
+		buffer.serializeBlock(filler.data(), (i32)filler.size());
+
+		u8 placeholder[20];
+		memset(placeholder, 0xAB, sizeof(placeholder));
+		for (size_t i = 0; i < sizes.size(); ++i) {
+			buffer.addHashFixup(buffer.pos + sizeof(placeholder), sizes[i], buffer.pos, digests[i].data);
+			buffer.serializeBlock(placeholder, sizeof(placeholder));
+			for (size_t done = 0; done < sizes[i];) {
+				size_t n = std::min(pieces[i], sizes[i] - done);
+				buffer.serializeBlock(data.data() + done, (i32)n);
+				done += n;
+			}
+		}
+		buffer.finalize();
+	};
+
+	std::vector<u8> expected;
+	std::vector<SHAHash> expectedDigests;
+	{
+		DataBuffer buffer;
+		buffer.setupVector(expected);
+		buffer.loading = false;
+		write(buffer, expectedDigests);
+		expected.resize(buffer.size);
+	}
+
+	std::vector<SHAHash> digests;
+	std::vector<u32> crcs;
+	{
+		FileSink sink;
+		CHECK(sink.open("resave_test_hashes.bin"));
+		sink.trackChunkCrcs(chunkSize);
+
+		DataBuffer buffer;
+		buffer.setupFile(sink);
+		write(buffer, digests);
+		crcs = sink.finishChunkCrcs();
+	}
+
+	CHECK(test_pak::readFile("resave_test_hashes.bin") == expected);
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		CHECK(memcmp(digests[i].data, expectedDigests[i].data, sizeof(digests[i].data)) == 0);
+	}
+
+	std::vector<u32> expectedCrcs;
+	for (size_t at = 0; at < expected.size(); at += chunkSize) {
+		expectedCrcs.emplace_back(CRC::MemCrc32(expected.data() + at, (i32)std::min(chunkSize, expected.size() - at)));
+	}
+	CHECK(crcs == expectedCrcs);
+}
+
+//A save that can't be written has to say so, instead of leaving a broken pak behind
+static void fileSinkReportsFailures() {
+	FileSink missing;
+	CHECK(!missing.open("resave_test_missing_dir/out.pak"));
+
+	//Opens fine, then every write fails with the disk full. Not every platform has one.
+	FileSink full;
+	if (!full.open("/dev/full")) {
+		return;
+	}
+
+	PakFile pak = test_pak::build();
+	DataBuffer buffer;
+	buffer.setupFile(full);
+	pak.serialize(buffer);
+	buffer.finalize();
+	CHECK(!full.flush());
+	CHECK(!full.good());
+}
+
+static void mappedLoadResaves() {
+	PakFile pak = test_pak::build();
+	auto expected = test_pak::save(pak);
+	test_pak::writeFile("resave_test_mapped.pak", expected);
+
+	auto mapped = MappedFile::open("resave_test_mapped.pak");
+	CHECK(mapped != nullptr);
+	if (!mapped) {
+		return;
+	}
+
+	PakFile loaded;
+	DataBuffer buffer;
+	buffer.setupMapped(mapped);
+	loaded.serialize(buffer);
+
+	CHECK(test_pak::song(loaded).audio.audioFiles[0].fileData.isView());
+	CHECK(test_pak::save(loaded) == expected);
+
+	//Saving over the file it came from, while the stem is still a view into it
+	std::vector<u32> crcs;
+	std::string error;
+	CHECK(loaded.saveToFile("resave_test_mapped.pak", PakSigFile::CHUNK_SIZE, crcs, error));
+	CHECK(test_pak::readFile("resave_test_mapped.pak") == expected);
+	CHECK(crcs == PakSigFile::chunkCrcs(expected.data(), expected.size()));
+	CHECK(loaded.file != mapped);
+	CHECK(test_pak::save(loaded) == expected);
+
+	CHECK(!loaded.saveToFile("resave_test_missing_dir/out.pak", PakSigFile::CHUNK_SIZE, crcs, error));
+	CHECK(!error.empty());
+}
+
+//Untouched entries of a mapped pak save straight out of the mapping, and whatever is saved the
+//output has to be what serializing everything again gives
+static void incrementalMatchesFullSave() {
+	PakFile pak = test_pak::build();
+	auto expected = test_pak::save(pak);
+	test_pak::writeFile("resave_test_incremental.pak", expected);
+
+	auto mapped = MappedFile::open("resave_test_incremental.pak");
+	CHECK(mapped != nullptr);
+	if (!mapped) {
+		return;
+	}
+
+	PakFile loaded;
+	DataBuffer buffer;
+	buffer.setupMapped(mapped);
+	loaded.serialize(buffer);
+	mapped.reset();
+
+	auto allSaved = [&]() {
+		for (auto &&e : loaded.entries) {
+			if (!e.saved || e.saved->bytes.file() != loaded.file) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	CHECK(allSaved());
+	CHECK(test_pak::save(loaded) == expected);
+	CHECK(allSaved());
+
+	auto &&artist = test_pak::meta(loaded).data.get(&loaded.entries[0].getHeader(), "Artist");
+	CHECK(artist != nullptr);
+	if (!artist) {
+		return;
+	}
+	std::get<StringProperty>(artist->value).str = "Someone Else";
+	loaded.entries[1].markDirty();
+
+	//Written somewhere that isn't mapped again, only the edited asset is serialized and it has
+	//nothing saved afterwards
+	auto edited = test_pak::save(loaded);
+	CHECK(edited != expected);
+	CHECK(!loaded.entries[0].saved && !loaded.entries[1].saved);
+	CHECK(loaded.entries[3].saved.has_value());
+	CHECK(test_pak::save(loaded) == edited);
+
+	//Saved over its own file, everything is saved in the new one
+	std::vector<u32> crcs;
+	std::string error;
+	CHECK(loaded.saveToFile("resave_test_incremental.pak", PakSigFile::CHUNK_SIZE, crcs, error));
+	CHECK(test_pak::readFile("resave_test_incremental.pak") == edited);
+	CHECK(allSaved());
+	CHECK(test_pak::save(loaded) == edited);
+
+	loaded.markAllDirty();
+	CHECK(test_pak::save(loaded) == edited);
+}
+
+static void listingMatchesIndex() {
+	PakFile pak = test_pak::build();
+	auto bytes = test_pak::save(pak);
+	test_pak::writeFile("resave_test_listing.pak", bytes);
+
+	auto listing = PakListing::read("resave_test_listing.pak");
+	CHECK(listing.has_value());
+	if (!listing) {
+		return;
+	}
+
+	CHECK(listing->mountPoint == pak.mountPoint);
+	CHECK(listing->entries.size() == pak.entries.size());
+	for (size_t i = 0; i < listing->entries.size() && i < pak.entries.size(); ++i) {
+		auto &&l = listing->entries[i];
+		auto &&e = pak.entries[i];
+		CHECK(l.name == e.name);
+		CHECK(l.offset == e.entryData.offset);
+		CHECK(l.size == e.entryData.size);
+		CHECK(memcmp(l.hash.data, e.entryData.hash.data, sizeof(l.hash.data)) == 0);
+	}
+
+	CHECK(!PakListing::read("resave_test_missing.pak").has_value());
+}
+
+int main() {
+	resaveIsIdentical();
+	parseExportsOnLoad();
+	headerGrowthMovesExports();
+	layoutIsExact();
+	fileSinkMatchesVector();
+	fileSinkFillsHashes();
+	fileSinkReportsFailures();
+	mappedLoadResaves();
+	incrementalMatchesFullSave();
+	listingMatchesIndex();
+	return testResult();
+}
@@ -0,0 +1,115 @@
+#include "test_common.h"
+
+#include <set>
+
+//forEach has to call every index exactly once and rethrow the lowest failing index's exception,
+//however many threads the pool has, and a pool has to be reusable job after job.
+
+static void everyIndexOnce() {
+	for (size_t count : { 0, 1, 2, 7, 1000 }) {
+		std::vector<std::atomic<i32>> calls(count);
+		parallel::forEach(count, [&](size_t i) { ++calls[i]; });
+
+		bool once = true;
+		for (auto &&c : calls) {
+			once &= c == 1;
+		}
+		CHECK(once);
+	}
+}
+
+static void lowestIndexThrows() {
+	std::vector<std::atomic<i32>> calls(100);
+	i32 thrown = -1;
+	try {
+		parallel::forEach(calls.size(), [&](size_t i) {
+			++calls[i];
+			if (i % 10 == 3) {
+				throw (i32)i;
+			}
+		});
+	}
+	catch (i32 i) {
+		thrown = i;
+	}
+
+	//Running on one thread stops at the first throw, the indices before it have run either way
+	CHECK(thrown == 3);
+	for (size_t i = 0; i <= 3; ++i) {
+		CHECK(calls[i] == 1);
+	}
+}
+
+static void nested() {
+	std::vector<std::atomic<i32>> calls(8 * 8);
+	parallel::forEach(8, [&](size_t i) {
+		parallel::forEach(8, [&](size_t j) { ++calls[i * 8 + j]; });
+	});
+
+	bool once = true;
+	for (auto &&c : calls) {
+		once &= c == 1;
+	}
+	CHECK(once);
+}
+
+//A pool of its own, so this runs on more than one thread even on a single core machine
+static void poolRunsEveryThread() {
+	parallel::Pool pool(3);
+	CHECK(pool.size() == 3);
+
+	for (i32 job = 0; job < 200; ++job) {
+		std::mutex lock;
+		std::set<std::thread::id> threads;
+		std::atomic<i32> calls{ 0 };
+		std::atomic<i32> nestedRuns{ 0 };
+
+		std::function<void()> work = [&]() {
+			++calls;
+			//Already inside a job, on the workers and on the calling thread alike
+			std::function<void()> inner = []() {};
+			if (pool.run(inner)) {
+				++nestedRuns;
+			}
+
+			std::lock_guard<std::mutex> l(lock);
+			threads.insert(std::this_thread::get_id());
+		};
+		CHECK(pool.run(work));
+		CHECK(calls == 4);
+		CHECK(threads.size() == 4);
+		CHECK(nestedRuns == 0);
+	}
+
+	//The calling thread's share throwing still waits for the workers
+	std::atomic<i32> finished{ 0 };
+	std::thread::id caller = std::this_thread::get_id();
+	std::function<void()> throwing = [&]() {
+		if (std::this_thread::get_id() == caller) {
+			throw 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		++finished;
+	};
+	bool caught = false;
+	try {
+		pool.run(throwing);
+	}
+	catch (i32) {
+		caught = true;
+	}
+	CHECK(caught);
+	CHECK(finished == 3);
+
+	parallel::Pool empty(0);
+	std::function<void()> nothing = []() {};
+	CHECK(!empty.run(nothing));
+}
+
+int main() {
+	everyIndexOnce();
+	lowestIndexThrows();
+	nested();
+	poolRunsEveryThread();
+	return testResult();
+}
@@ -0,0 +1,60 @@
+#include "bench_common.h"
+
+//A full save of a pak with many songs in it. Entries are serialized and hashed on
+//parallel::workerCount() threads, so run it with FUSER_WORKERS=1, 2, 4... to see how the
+//save scales with cores.
+
+static const i32 songs = 48;
+static const size_t moggSize = 1024 * 1024;
+
+//Copies of the test pak's entries under their own folders. The exports point at their header
+//by address, so every entry is reserved up front and the copies are pointed at their own.
+static PakFile manySongs() {
+	PakFile pak = test_pak::build("Bench Song", moggSize);
+	size_t perSong = pak.entries.size();
+	std::vector<size_t> headerIdx(perSong);
+	for (size_t j = 0; j < perSong; ++j) {
+		if (auto data = std::get_if<PakFile::PakEntry::PakAssetData>(&pak.entries[j].data)) {
+			headerIdx[j] = data->pakHeader - pak.entries.data();
+		}
+	}
+
+	std::vector<PakFile::PakEntry> first = std::move(pak.entries);
+	pak.entries.clear();
+	pak.entries.reserve(perSong * songs);
+	for (i32 k = 0; k < songs; ++k) {
+		size_t base = pak.entries.size();
+		for (size_t j = 0; j < perSong; ++j) {
+			auto &&e = pak.entries.emplace_back(first[j]);
+			e.name = "song" + std::to_string(k) + "/" + e.name;
+			if (auto data = std::get_if<PakFile::PakEntry::PakAssetData>(&e.data)) {
+				data->pakHeader = &pak.entries[base + headerIdx[j]];
+			}
+		}
+	}
+	return pak;
+}
+
+int main() {
+	PakFile pak = manySongs();
+
+	std::vector<u8> reference;
+	std::vector<u8> bytes;
+	double ms = bench::bestMs(5, [&]() {
+		pak.markAllDirty();
+		bytes = test_pak::save(pak);
+		if (reference.empty()) {
+			reference = bytes;
+		}
+	});
+	CHECK(bytes == reference);
+
+	PakFile loaded;
+	test_pak::load(loaded, bytes);
+	CHECK(loaded.entries.size() == pak.entries.size());
+
+	//The CRC should be the same for every worker count
+	printf("workers=%zu: %zu entries, %.1f MB, full save %.1f ms (%.0f MB/s), crc %08x\n", parallel::workerCount(),
+		pak.entries.size(), bytes.size() / (1024.0 * 1024), ms, bench::mbPerSec(bytes.size(), ms), CRC::MemCrc32(bytes.data(), (i32)bytes.size()));
+	return testResult();
+}
@@ -0,0 +1,60 @@
+#include "bench_common.h"
+
+//serializeWithSize on a mogg sized buffer, against the element at a time loop it used before
+//trivially copyable ranges were copied as one block.
+
+static const i32 bufferSize = 50 * 1024 * 1024;
+
+template<typename T>
+static void run(const char *name) {
+	i32 count = bufferSize / sizeof(T);
+	std::vector<T> src(count);
+	for (i32 i = 0; i < count; ++i) {
+		src[i] = (T)(i * 31);
+	}
+
+	std::vector<u8> saved;
+	double savePerElement = bench::bestMs(3, [&]() {
+		saved.clear();
+		DataBuffer out;
+		out.setupVector(saved);
+		out.loading = false;
+		for (i32 i = 0; i < count; ++i) {
+			out.serialize(src[i]);
+		}
+	});
+	double saveBulk = bench::bestMs(3, [&]() {
+		saved.clear();
+		DataBuffer out;
+		out.setupVector(saved);
+		out.loading = false;
+		out.serializeWithSize(src, count);
+		out.finalize();
+		saved.resize(out.size);
+	});
+
+	std::vector<T> loaded;
+	double loadPerElement = bench::bestMs(3, [&]() {
+		loaded.assign(count, T());
+		DataBuffer in;
+		in.setupVector(saved);
+		for (i32 i = 0; i < count; ++i) {
+			in.serialize(loaded[i]);
+		}
+	});
+	double loadBulk = bench::bestMs(3, [&]() {
+		DataBuffer in;
+		in.setupVector(saved);
+		in.serializeWithSize(loaded, count);
+	});
+	CHECK(loaded == src);
+
+	printf("%-5s save: per element %7.1f ms, bulk %6.1f ms (%.0f MB/s)\n", name, savePerElement, saveBulk, bench::mbPerSec(bufferSize, saveBulk));
+	printf("%-5s load: per element %7.1f ms, bulk %6.1f ms (%.0f MB/s)\n", name, loadPerElement, loadBulk, bench::mbPerSec(bufferSize, loadBulk));
+}
+
+int main() {
+	run<u8>("u8");
+	run<float>("float");
+	return testResult();
+}
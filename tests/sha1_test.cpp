@@ -0,0 +1,79 @@
+#include "test_common.h"
+
+#include <random>
+
+//Every block function the CPU can run has to agree with Scalar, whatever the length and however
+//the input is split across update() calls.
+
+static std::string digestOf(const u8 *data, size_t size, size_t split) {
+	SHA1 sha;
+	sha.reset();
+	for (size_t at = 0; at < size; at += split) {
+		sha.update(data + at, std::min(split, size - at));
+	}
+	sha.finalize();
+	return std::string(sha.digest, sizeof(sha.digest));
+}
+
+static std::string hex(const std::string &digest) {
+	static const char digits[] = "0123456789abcdef";
+	std::string out;
+	for (u8 c : digest) {
+		out += digits[c >> 4];
+		out += digits[c & 0xF];
+	}
+	return out;
+}
+
+static const SHA1::Impl allImpls[] = { SHA1::Impl::Scalar, SHA1::Impl::ShaNi, SHA1::Impl::ArmV8 };
+
+static void knownVectors() {
+	std::string million(1000000, 'a');
+	for (auto impl : allImpls) {
+		if (!SHA1::setImplementation(impl)) {
+			continue;
+		}
+
+		CHECK(hex(digestOf(nullptr, 0, 1)) == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+		CHECK(hex(digestOf((const u8*)"abc", 3, 3)) == "a9993e364706816aba3e25717850c26c9cd0d89d");
+		CHECK(hex(digestOf((const u8*)million.data(), million.size(), 4096)) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
+}
+
+static void matchesScalar() {
+	std::mt19937 rng(1);
+	std::vector<u8> data(200000);
+	for (auto &&b : data) {
+		b = (u8)rng();
+	}
+
+	size_t cases = 0;
+	for (i32 c = 0; c < 1000; ++c) {
+		size_t size = c < 800 ? rng() % 300 : rng() % data.size();
+		size_t split = (c & 1) ? 1 + rng() % 200 : std::max<size_t>(size, 1);
+
+		SHA1::setImplementation(SHA1::Impl::Scalar);
+		auto expected = digestOf(data.data(), size, split);
+		for (auto impl : allImpls) {
+			if (!SHA1::setImplementation(impl)) {
+				continue;
+			}
+
+			CHECK(digestOf(data.data(), size, split) == expected);
+			++cases;
+		}
+	}
+
+	for (auto impl : allImpls) {
+		printf("%s: %s\n", SHA1::name(impl), SHA1::supported(impl) ? "checked" : "not supported here");
+	}
+	CHECK(cases >= 1000);
+}
+
+int main() {
+	auto original = SHA1::implementation();
+	knownVectors();
+	matchesScalar();
+	SHA1::setImplementation(original);
+	return testResult();
+}
@@ -0,0 +1,259 @@
+#pragma once
+#include "uasset.h"
+
+#include <cstdio>
+#include <iterator>
+
+//Checks keep going after a failure so one run reports everything, main() returns testResult()
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		++testFailures; \
+	} \
+} while (0)
+
+static int testResult() {
+	if (testFailures == 0) {
+		printf("ok\n");
+	}
+	return testFailures == 0 ? 0 : 1;
+}
+
+namespace test_pak {
+	inline StringRef32 name(AssetHeader &h, const std::string &str) {
+		return h.findOrCreateName(str);
+	}
+
+	inline PropertyData prop(AssetHeader &h, const std::string &propName, const std::string &type, asset_helper::PropertyValue v, i64 length) {
+		PropertyData p;
+		p.nameRef = name(h, propName);
+		p.widgetData = 0;
+		p.typeRef = StringRef64(name(h, type));
+		p.length = length;
+		p.value = std::move(v);
+		return p;
+	}
+
+	//A header with one import (the class) and one export, like the game's single object assets
+	inline AssetHeader header(const std::string &className) {
+		AssetHeader h{};
+		h.magic = 0x9E2A83C1;
+		h.legacyFileVersion = -7;
+		h.UE4FileVersion = 517;
+		h.name = "None";
+		h.packageFlags = 0x80000000;
+		name(h, "None");
+		name(h, "/Script/CoreUObject");
+		name(h, "Class");
+		name(h, className);
+		name(h, "Default__" + className);
+		h.localizationId = "";
+
+		Link l{};
+		l.base = name(h, "/Script/CoreUObject").ref;
+		l.cls = name(h, "Class").ref;
+		l.link = 0;
+		l.property = name(h, className).ref;
+		h.links.push_back(l);
+		h.importCount = 1;
+
+		Catagory c{};
+		c.classIdx = -1;
+		c.objectName = name(h, "TestObject").ref;
+		c.objectFlags = 8;
+		c.isAsset = 1;
+		h.catagories.push_back(c);
+		h.exportsCount = 1;
+
+		CatagoryRef group;
+		group.data = { 1, 2, 3 };
+		h.catagoryGroups.push_back(group);
+
+		h.generations.emplace_back();
+		h.savedByVersion.major = 4;
+		h.savedByVersion.minor = 26;
+		h.savedByVersion.branch = "++UE4+Release-4.26";
+		h.compatibleWithVersion = h.savedByVersion;
+		h.uexpData = { 0 };
+		h.preloadDependencies = { -1 };
+		h.preloadDependencyCount = 1;
+		//Non-zero so the registry sections are written, as they are in cooked assets
+		h.totalHeaderSize = 1;
+
+		CustomVersion cv{};
+		cv.version = 3;
+		h.customVersions.push_back(cv);
+		return h;
+	}
+
+	inline PakFile::PakEntry &addEntry(PakFile &pak, const std::string &path) {
+		auto &&e = pak.entries.emplace_back();
+		e.name = path;
+		e.entryData = {};
+		return e;
+	}
+
+	//nodes owns the property nodes in value, if it has any
+	inline void addExports(PakFile &pak, const std::string &path, size_t headerIdx, AssetData::CatagoryValue value, std::shared_ptr<Arena> nodes = nullptr) {
+		PakFile::PakEntry::PakAssetData pakData;
+		pakData.pakHeader = &pak.entries[headerIdx];
+		if (nodes) {
+			pakData.arena = std::move(nodes);
+		}
+		pakData.data.catagoryValues.push_back(std::move(value));
+		pakData.data.footer = 0x9E2A83C1;
+		addEntry(pak, path).data = std::move(pakData);
+	}
+
+	//A song meta object with most property types, and a song asset holding a mogg. The mogg is
+	//bigger than FileSink's window, so streamed saves cross a window boundary inside it.
+	inline PakFile build(const std::string &title = "Test Song", size_t moggSize = 5 * 1024 * 1024 + 17) {
+		PakFile pak;
+		pak.info_footer.magic = 0x5A6F12E1;
+		pak.info_footer.version = EPakVersion::FNAME_BASED_COMPRESSION_METHOD;
+		memset(&pak.info_footer.guid, 0, sizeof(Guid));
+		pak.info_footer.isEncrypted = false;
+		memset(pak.info_footer.compressionName, 0, sizeof(pak.info_footer.compressionName));
+		pak.mountPoint = "../../../Fuser/Content/";
+		//The exports point at their header, so the entries must not move
+		pak.entries.reserve(4);
+
+		{
+			auto &&h = header("FuserSongMeta");
+			auto nodes = std::make_shared<Arena>();
+			IPropertyDataList list;
+
+			TextProperty text{};
+			text.flag = 0;
+			text.historyType = -1;
+			text.extras = 1;
+			text.strings = { title };
+			list.properties.push_back(prop(h, "Title", "TextProperty", std::move(text), 0));
+
+			PrimitiveProperty<i32> bpm{};
+			bpm.data = 128;
+			list.properties.push_back(prop(h, "BPM", "IntProperty", bpm, 4));
+
+			PrimitiveProperty<float> gain{};
+			gain.data = 1.5f;
+			list.properties.push_back(prop(h, "Gain", "FloatProperty", gain, 4));
+
+			StringProperty artist;
+			artist.str = "Test Artist";
+			list.properties.push_back(prop(h, "Artist", "StrProperty", artist, 0));
+
+			EnumProperty key{};
+			key.enumType = StringRef64(name(h, "EKey"));
+			key.value = StringRef64(name(h, "EKey::A"));
+			list.properties.push_back(prop(h, "Key", "EnumProperty", key, 8));
+
+			BoolProperty streamOptimized{};
+			streamOptimized.value = true;
+			list.properties.push_back(prop(h, "IsStreamOptimized", "BoolProperty", streamOptimized, 0));
+
+			ArrayProperty beats;
+			beats.arrayType = StringRef64(name(h, "IntProperty"));
+			for (i32 i = 0; i < 5; ++i) {
+				auto v = nodes->make<IPropertyValue>();
+				PrimitiveProperty<i32> beat{};
+				beat.data = i * 3;
+				v->v = beat;
+				beats.values.push_back(v);
+			}
+			list.properties.push_back(prop(h, "PickupBeats", "ArrayProperty", std::move(beats), 0));
+
+			StructProperty transposes;
+			memset(&transposes.guid, 0, sizeof(Guid));
+			transposes.type = StringRef64(name(h, "Inner"));
+			auto innerList = nodes->make<IPropertyDataList>();
+			PrimitiveProperty<i32> innerVal{};
+			innerVal.data = 42;
+			innerList->properties.push_back(prop(h, "InnerVal", "IntProperty", innerVal, 4));
+			auto inner = nodes->make<IPropertyValue>();
+			inner->v = innerList;
+			transposes.values.push_back(inner);
+			list.properties.push_back(prop(h, "Transposes", "StructProperty", std::move(transposes), 0));
+
+			addEntry(pak, "DLC/Songs/test/Meta_test.uasset").data = std::move(h);
+
+			UObject object;
+			object.data = std::move(list);
+			AssetData::CatagoryValue value;
+			value.parsed = std::move(object);
+			value.extraData = { 0, 0, 0, 0 };
+			addExports(pak, "DLC/Songs/test/Meta_test.uexp", 0, std::move(value), nodes);
+		}
+
+		{
+			auto &&h = header("HmxMidiSongAsset");
+			HmxAssetFile asset{};
+			asset.assetName = StringRef64(name(h, "test_mogg"));
+			PrimitiveProperty<i32> someInt{};
+			someInt.data = 7;
+			asset.propList.properties.push_back(prop(h, "SomeInt", "IntProperty", someInt, 4));
+			asset.someHash = 0x1234;
+			asset.originalFilename = "test.mogg";
+			asset.unk2 = 1;
+
+			HmxAudio::PackageFile file{};
+			file.fileName = "test.mogg";
+			file.fileType = "MoggSampleResource";
+			HmxAudio::PackageFile::MoggSampleResourceHeader moggHeader{};
+			memcpy(moggHeader.identifier, "MOGG", 4);
+			moggHeader.sample_rate = 48000;
+			file.resourceHeader = moggHeader;
+
+			auto &&mogg = file.fileData.owned();
+			mogg.resize(moggSize);
+			for (size_t i = 0; i < mogg.size(); ++i) {
+				mogg[i] = (u8)((i * 2654435761u) >> 13);
+			}
+			asset.audio.audioFiles.push_back(std::move(file));
+
+			addEntry(pak, "Audio/Songs/test/test_mogg.uasset").data = std::move(h);
+
+			AssetData::CatagoryValue value;
+			value.parsed = std::move(asset);
+			addExports(pak, "Audio/Songs/test/test_mogg.uexp", 2, std::move(value));
+		}
+
+		return pak;
+	}
+
+	inline std::vector<u8> save(PakFile &pak) {
+		std::vector<u8> bytes;
+		DataBuffer buffer;
+		buffer.setupVector(bytes);
+		buffer.loading = false;
+		pak.serialize(buffer);
+		buffer.finalize();
+		bytes.resize(buffer.size);
+		return bytes;
+	}
+
+	inline void load(PakFile &pak, std::vector<u8> bytes) {
+		DataBuffer buffer;
+		buffer.setupVector(bytes);
+		pak.serialize(buffer);
+	}
+
+	inline void writeFile(const std::string &path, const std::vector<u8> &bytes) {
+		std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+		file.write((const char*)bytes.data(), bytes.size());
+	}
+
+	inline std::vector<u8> readFile(const std::string &path) {
+		std::ifstream file(path, std::ios_base::binary);
+		return std::vector<u8>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	inline UObject &meta(PakFile &pak) {
+		return std::get<UObject>(pak.entries[1].getData().data.catagoryValues[0].value());
+	}
+
+	inline HmxAssetFile &song(PakFile &pak) {
+		return std::get<HmxAssetFile>(pak.entries[3].getData().data.catagoryValues[0].value());
+	}
+}